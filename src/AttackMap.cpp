@@ -0,0 +1,175 @@
+#include "AttackMap.h"
+
+#include <immintrin.h>
+#include <intrin.h>
+
+// Squares that a shift towards a file must not land on, to stop pieces wrapping around the board edge
+static const unsigned long long NOT_A_FILE  = 0b1111111011111110111111101111111011111110111111101111111011111110;
+static const unsigned long long NOT_AB_FILE = 0b1111110011111100111111001111110011111100111111001111110011111100;
+static const unsigned long long NOT_H_FILE  = 0b0111111101111111011111110111111101111111011111110111111101111111;
+static const unsigned long long NOT_GH_FILE = 0b0011111100111111001111110011111100111111001111110011111100111111;
+static const unsigned long long ALL_FILES   = 0b1111111111111111111111111111111111111111111111111111111111111111;
+
+AttackMap::SliderAttacks AttackMap::sliderAttacks = &AttackMap::sliderAttacksScalar;
+
+bool AttackMap::vectorized = false;
+
+void AttackMap::initialize( bool allowVectorized )
+{
+    setVectorized( allowVectorized && isAVX2Supported() );
+}
+
+bool AttackMap::isAVX2Supported()
+{
+    int info[ 4 ];
+
+    __cpuid( info, 0 );
+    if ( info[ 0 ] < 7 )
+    {
+        return false;
+    }
+
+    // The CPU has to support AVX and the OS has to be saving the YMM registers (OSXSAVE, then XCR0 bits 1 and 2)
+    __cpuid( info, 1 );
+    if ( ( info[ 2 ] & ( 1 << 27 ) ) == 0 || ( info[ 2 ] & ( 1 << 28 ) ) == 0 )
+    {
+        return false;
+    }
+
+    if ( ( _xgetbv( 0 ) & 0b110 ) != 0b110 )
+    {
+        return false;
+    }
+
+    __cpuidex( info, 7, 0 );
+    return ( info[ 1 ] & ( 1 << 5 ) ) != 0;
+}
+
+unsigned long long AttackMap::getAttacks( const unsigned long long pawns,
+                                          const unsigned long long knights,
+                                          const unsigned long long diagonalSliders,
+                                          const unsigned long long orthogonalSliders,
+                                          const unsigned long long king,
+                                          const unsigned long long occupiedSquares,
+                                          const bool white )
+{
+    return getLeaperAttacks( pawns, knights, king, white ) | getSliderAttacks( diagonalSliders, orthogonalSliders, occupiedSquares );
+}
+
+unsigned long long AttackMap::getLeaperAttacks( const unsigned long long pawns,
+                                                const unsigned long long knights,
+                                                const unsigned long long king,
+                                                const bool white )
+{
+    unsigned long long attacks;
+
+    // Pawns
+    if ( white )
+    {
+        attacks = ( ( pawns & NOT_H_FILE ) << 9 ) | ( ( pawns & NOT_A_FILE ) << 7 );
+    }
+    else
+    {
+        attacks = ( ( pawns & NOT_A_FILE ) >> 9 ) | ( ( pawns & NOT_H_FILE ) >> 7 );
+    }
+
+    // Knights - one and two files either side, then two and one ranks up and down
+    const unsigned long long oneFile = ( ( knights << 1 ) & NOT_A_FILE ) | ( ( knights >> 1 ) & NOT_H_FILE );
+    const unsigned long long twoFiles = ( ( knights << 2 ) & NOT_AB_FILE ) | ( ( knights >> 2 ) & NOT_GH_FILE );
+
+    attacks |= ( oneFile << 16 ) | ( oneFile >> 16 ) | ( twoFiles << 8 ) | ( twoFiles >> 8 );
+
+    // King - sideways, then that row up and down
+    const unsigned long long kingRow = king | ( ( king << 1 ) & NOT_A_FILE ) | ( ( king >> 1 ) & NOT_H_FILE );
+
+    attacks |= ( kingRow ^ king ) | ( kingRow << 8 ) | ( kingRow >> 8 );
+
+    return attacks;
+}
+
+/// <summary>
+/// Shift a bitboard towards higher squares for a positive offset and lower squares for a negative one
+/// </summary>
+static inline unsigned long long shift( unsigned long long mask, int offset )
+{
+    return offset > 0 ? mask << offset : mask >> -offset;
+}
+
+/// <summary>
+/// Kogge-Stone occluded fill in one direction, returning the squares attacked by the sliders in that direction
+/// </summary>
+/// <param name="sliders">the sliding pieces</param>
+/// <param name="emptySquares">the squares sliders can pass through</param>
+/// <param name="offset">the square offset of one step in this direction</param>
+/// <param name="wrapMask">squares a step in this direction can land on without wrapping around the board</param>
+static inline unsigned long long occludedFillAttacks( unsigned long long sliders, unsigned long long emptySquares, int offset, unsigned long long wrapMask )
+{
+    emptySquares &= wrapMask;
+
+    sliders |= emptySquares & shift( sliders, offset );
+    emptySquares &= shift( emptySquares, offset );
+    sliders |= emptySquares & shift( sliders, offset * 2 );
+    emptySquares &= shift( emptySquares, offset * 2 );
+    sliders |= emptySquares & shift( sliders, offset * 4 );
+
+    // One more step to include the blocker (or edge square) at the end of each ray
+    return shift( sliders, offset ) & wrapMask;
+}
+
+unsigned long long AttackMap::sliderAttacksScalar( const unsigned long long diagonalSliders, const unsigned long long orthogonalSliders, const unsigned long long emptySquares )
+{
+    return occludedFillAttacks( orthogonalSliders, emptySquares, 8, ALL_FILES ) |
+           occludedFillAttacks( orthogonalSliders, emptySquares, -8, ALL_FILES ) |
+           occludedFillAttacks( orthogonalSliders, emptySquares, 1, NOT_A_FILE ) |
+           occludedFillAttacks( orthogonalSliders, emptySquares, -1, NOT_H_FILE ) |
+           occludedFillAttacks( diagonalSliders, emptySquares, 9, NOT_A_FILE ) |
+           occludedFillAttacks( diagonalSliders, emptySquares, 7, NOT_H_FILE ) |
+           occludedFillAttacks( diagonalSliders, emptySquares, -7, NOT_A_FILE ) |
+           occludedFillAttacks( diagonalSliders, emptySquares, -9, NOT_H_FILE );
+}
+
+unsigned long long AttackMap::sliderAttacksAVX2( const unsigned long long diagonalSliders, const unsigned long long orthogonalSliders, const unsigned long long emptySquares )
+{
+    // Four lanes, one direction each - north, north-east, north-west and east shift left (towards h8)
+    // and south, south-west, south-east and west use the same shift amounts to the right (towards a1)
+    // Lanes are listed high to low in _mm256_set_epi64x
+    const __m256i shift1 = _mm256_set_epi64x( 1, 7, 9, 8 );
+    const __m256i shift2 = _mm256_slli_epi64( shift1, 1 );
+    const __m256i shift4 = _mm256_slli_epi64( shift1, 2 );
+
+    const __m256i leftWrap = _mm256_set_epi64x( NOT_A_FILE, NOT_H_FILE, NOT_A_FILE, ALL_FILES );
+    const __m256i rightWrap = _mm256_set_epi64x( NOT_H_FILE, NOT_A_FILE, NOT_H_FILE, ALL_FILES );
+
+    const __m256i sliders = _mm256_set_epi64x( orthogonalSliders, diagonalSliders, diagonalSliders, orthogonalSliders );
+    const __m256i empty = _mm256_set1_epi64x( emptySquares );
+
+    // Left shifting directions
+    __m256i generator = sliders;
+    __m256i propagator = _mm256_and_si256( empty, leftWrap );
+
+    generator = _mm256_or_si256( generator, _mm256_and_si256( propagator, _mm256_sllv_epi64( generator, shift1 ) ) );
+    propagator = _mm256_and_si256( propagator, _mm256_sllv_epi64( propagator, shift1 ) );
+    generator = _mm256_or_si256( generator, _mm256_and_si256( propagator, _mm256_sllv_epi64( generator, shift2 ) ) );
+    propagator = _mm256_and_si256( propagator, _mm256_sllv_epi64( propagator, shift2 ) );
+    generator = _mm256_or_si256( generator, _mm256_and_si256( propagator, _mm256_sllv_epi64( generator, shift4 ) ) );
+
+    __m256i attacks = _mm256_and_si256( _mm256_sllv_epi64( generator, shift1 ), leftWrap );
+
+    // Right shifting directions
+    generator = sliders;
+    propagator = _mm256_and_si256( empty, rightWrap );
+
+    generator = _mm256_or_si256( generator, _mm256_and_si256( propagator, _mm256_srlv_epi64( generator, shift1 ) ) );
+    propagator = _mm256_and_si256( propagator, _mm256_srlv_epi64( propagator, shift1 ) );
+    generator = _mm256_or_si256( generator, _mm256_and_si256( propagator, _mm256_srlv_epi64( generator, shift2 ) ) );
+    propagator = _mm256_and_si256( propagator, _mm256_srlv_epi64( propagator, shift2 ) );
+    generator = _mm256_or_si256( generator, _mm256_and_si256( propagator, _mm256_srlv_epi64( generator, shift4 ) ) );
+
+    attacks = _mm256_or_si256( attacks, _mm256_and_si256( _mm256_srlv_epi64( generator, shift1 ), rightWrap ) );
+
+    // Combine the four lanes
+    __m128i combined = _mm_or_si128( _mm256_castsi256_si128( attacks ), _mm256_extracti128_si256( attacks, 1 ) );
+    combined = _mm_or_si128( combined, _mm_unpackhi_epi64( combined, combined ) );
+
+    return static_cast<unsigned long long>( _mm_cvtsi128_si64( combined ) );
+}
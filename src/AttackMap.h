@@ -0,0 +1,96 @@
+#pragma once
+
+/// <summary>
+/// Works out every square attacked by one side in a single pass, rather than one square at a time.
+/// Slider attacks use Kogge-Stone occluded fills, four directions at a time in an AVX2 register where
+/// the CPU supports it and one direction at a time otherwise
+/// </summary>
+class AttackMap
+{
+private:
+    typedef unsigned long long ( *SliderAttacks )( const unsigned long long diagonalSliders, const unsigned long long orthogonalSliders, const unsigned long long emptySquares );
+
+    static SliderAttacks sliderAttacks;
+
+    static bool vectorized;
+
+    static unsigned long long sliderAttacksScalar( const unsigned long long diagonalSliders, const unsigned long long orthogonalSliders, const unsigned long long emptySquares );
+    static unsigned long long sliderAttacksAVX2( const unsigned long long diagonalSliders, const unsigned long long orthogonalSliders, const unsigned long long emptySquares );
+
+public:
+    /// <summary>
+    /// Returns true if the CPU and OS support AVX2
+    /// </summary>
+    static bool isAVX2Supported();
+
+    /// <summary>
+    /// Pick the slider implementation for this CPU
+    /// </summary>
+    /// <param name="allowVectorized">false to force the scalar implementation</param>
+    static void initialize( bool allowVectorized = true );
+
+    /// <summary>
+    /// Switch implementation without checking the CPU again, e.g. to run both side by side. Only choose AVX2 if
+    /// the CPU supports it
+    /// </summary>
+    /// <param name="enabled">true for the AVX2 implementation, false for scalar</param>
+    static void setVectorized( bool enabled )
+    {
+        vectorized = enabled;
+        sliderAttacks = enabled ? &sliderAttacksAVX2 : &sliderAttacksScalar;
+    }
+
+    /// <summary>
+    /// Returns true if the AVX2 implementation is in use
+    /// </summary>
+    static bool isVectorized()
+    {
+        return vectorized;
+    }
+
+    /// <summary>
+    /// Squares attacked by one side's pawns, knights and king, which don't depend on the occupancy
+    /// </summary>
+    /// <param name="pawns">the attacking pawns</param>
+    /// <param name="knights">the attacking knights</param>
+    /// <param name="king">the attacking king</param>
+    /// <param name="white">true if the attacking side is white</param>
+    /// <returns>a mask of all attacked squares</returns>
+    static unsigned long long getLeaperAttacks( const unsigned long long pawns,
+                                                const unsigned long long knights,
+                                                const unsigned long long king,
+                                                const bool white );
+
+    /// <summary>
+    /// Squares attacked by one side's sliding pieces
+    /// </summary>
+    /// <param name="diagonalSliders">the attacking bishops and queens</param>
+    /// <param name="orthogonalSliders">the attacking rooks and queens</param>
+    /// <param name="occupiedSquares">the squares that block sliders</param>
+    /// <returns>a mask of all attacked squares</returns>
+    static unsigned long long getSliderAttacks( const unsigned long long diagonalSliders,
+                                                const unsigned long long orthogonalSliders,
+                                                const unsigned long long occupiedSquares )
+    {
+        return sliderAttacks( diagonalSliders, orthogonalSliders, ~occupiedSquares );
+    }
+
+    /// <summary>
+    /// All squares attacked by one side's pieces
+    /// </summary>
+    /// <param name="pawns">the attacking pawns</param>
+    /// <param name="knights">the attacking knights</param>
+    /// <param name="diagonalSliders">the attacking bishops and queens</param>
+    /// <param name="orthogonalSliders">the attacking rooks and queens</param>
+    /// <param name="king">the attacking king</param>
+    /// <param name="occupiedSquares">the squares that block sliders</param>
+    /// <param name="white">true if the attacking side is white</param>
+    /// <returns>a mask of all attacked squares</returns>
+    static unsigned long long getAttacks( const unsigned long long pawns,
+                                          const unsigned long long knights,
+                                          const unsigned long long diagonalSliders,
+                                          const unsigned long long orthogonalSliders,
+                                          const unsigned long long king,
+                                          const unsigned long long occupiedSquares,
+                                          const bool white );
+};
@@ -0,0 +1,582 @@
+#include "BatchCounter.h"
+
+#include <immintrin.h>
+#include <intrin.h>
+#include <stdlib.h>
+
+#include "AttackMap.h"
+#include "BitBoard.h"
+#include "Board.h"
+
+// Castling squares, white's side of the board as every lane has white to move
+static const unsigned long long WHITE_KINGSIDE_PATH  = 0b01100000; // f1, g1
+static const unsigned long long WHITE_QUEENSIDE_PATH = 0b00001100; // c1, d1
+
+/// <summary>
+/// Squares a one step shift by offset can land on without wrapping around the board edge
+/// </summary>
+static unsigned long long wrapMask( int offset )
+{
+    // Work out how many files the offset moves by: -2 to 2
+    switch ( ( ( offset + 67 ) & 7 ) - 3 )
+    {
+        case 1:
+            return ~BitBoard::getFileMask( 0 );
+
+        case 2:
+            return ~( BitBoard::getFileMask( 0 ) | BitBoard::getFileMask( 1 ) );
+
+        case -1:
+            return ~BitBoard::getFileMask( 7 );
+
+        case -2:
+            return ~( BitBoard::getFileMask( 7 ) | BitBoard::getFileMask( 6 ) );
+
+        default:
+            return ~0ull;
+    }
+}
+
+// Lane types - each provides the same operations over a vector of bitboards, one position per lane
+
+struct ScalarLanes
+{
+    typedef unsigned long long V;
+
+    static const size_t WIDTH = 1;
+
+    static V load( const unsigned long long* p ) { return *p; }
+    static void store( unsigned long long* p, V v ) { *p = v; }
+    static V set1( unsigned long long value ) { return value; }
+    static V zero() { return 0; }
+
+    static V and_( V a, V b ) { return a & b; }
+    static V or_( V a, V b ) { return a | b; }
+    static V xor_( V a, V b ) { return a ^ b; }
+    static V andNot( V a, V b ) { return ~a & b; }
+    static V add( V a, V b ) { return a + b; }
+
+    template <int OFFSET> static V shift( V v ) { return OFFSET > 0 ? v << ( OFFSET & 63 ) : v >> ( -OFFSET & 63 ); }
+
+    static V popcount( V v ) { return __popcnt64( v ); }
+    static V isZero( V v ) { return v == 0 ? ~0ull : 0; }
+    static V isEqual( V a, V b ) { return a == b ? ~0ull : 0; }
+};
+
+struct AVX2Lanes
+{
+    typedef __m256i V;
+
+    static const size_t WIDTH = 4;
+
+    static V load( const unsigned long long* p ) { return _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p ) ); }
+    static void store( unsigned long long* p, V v ) { _mm256_storeu_si256( reinterpret_cast<__m256i*>( p ), v ); }
+    static V set1( unsigned long long value ) { return _mm256_set1_epi64x( static_cast<long long>( value ) ); }
+    static V zero() { return _mm256_setzero_si256(); }
+
+    static V and_( V a, V b ) { return _mm256_and_si256( a, b ); }
+    static V or_( V a, V b ) { return _mm256_or_si256( a, b ); }
+    static V xor_( V a, V b ) { return _mm256_xor_si256( a, b ); }
+    static V andNot( V a, V b ) { return _mm256_andnot_si256( a, b ); }
+    static V add( V a, V b ) { return _mm256_add_epi64( a, b ); }
+
+    template <int OFFSET> static V shift( V v ) { return OFFSET > 0 ? _mm256_slli_epi64( v, OFFSET & 63 ) : _mm256_srli_epi64( v, -OFFSET & 63 ); }
+
+    // No 64-bit popcount in AVX2, so count nibbles with a shuffle lookup and sum the bytes of each lane
+    static V popcount( V v )
+    {
+        const __m256i lookup = _mm256_setr_epi8( 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 );
+        const __m256i nibble = _mm256_set1_epi8( 0x0f );
+
+        __m256i low = _mm256_shuffle_epi8( lookup, _mm256_and_si256( v, nibble ) );
+        __m256i high = _mm256_shuffle_epi8( lookup, _mm256_and_si256( _mm256_srli_epi16( v, 4 ), nibble ) );
+
+        return _mm256_sad_epu8( _mm256_add_epi8( low, high ), _mm256_setzero_si256() );
+    }
+
+    static V isZero( V v ) { return _mm256_cmpeq_epi64( v, _mm256_setzero_si256() ); }
+    static V isEqual( V a, V b ) { return _mm256_cmpeq_epi64( a, b ); }
+};
+
+struct AVX512Lanes
+{
+    typedef __m512i V;
+
+    static const size_t WIDTH = 8;
+
+    static V load( const unsigned long long* p ) { return _mm512_loadu_si512( p ); }
+    static void store( unsigned long long* p, V v ) { _mm512_storeu_si512( p, v ); }
+    static V set1( unsigned long long value ) { return _mm512_set1_epi64( static_cast<long long>( value ) ); }
+    static V zero() { return _mm512_setzero_si512(); }
+
+    static V and_( V a, V b ) { return _mm512_and_si512( a, b ); }
+    static V or_( V a, V b ) { return _mm512_or_si512( a, b ); }
+    static V xor_( V a, V b ) { return _mm512_xor_si512( a, b ); }
+    static V andNot( V a, V b ) { return _mm512_andnot_si512( a, b ); }
+    static V add( V a, V b ) { return _mm512_add_epi64( a, b ); }
+
+    template <int OFFSET> static V shift( V v ) { return OFFSET > 0 ? _mm512_slli_epi64( v, OFFSET & 63 ) : _mm512_srli_epi64( v, -OFFSET & 63 ); }
+
+    static V popcount( V v ) { return _mm512_popcnt_epi64( v ); }
+    static V isZero( V v ) { return _mm512_maskz_set1_epi64( _mm512_cmpeq_epi64_mask( v, _mm512_setzero_si512() ), -1 ); }
+    static V isEqual( V a, V b ) { return _mm512_maskz_set1_epi64( _mm512_cmpeq_epi64_mask( a, b ), -1 ); }
+};
+
+BatchCounter::Kernel BatchCounter::kernel = &BatchCounter::countLanes<ScalarLanes>;
+size_t BatchCounter::width = 1;
+const char* BatchCounter::implementationName = "scalar";
+
+/// <summary>
+/// One step in a direction for every set bit, dropping any that would wrap around the board
+/// </summary>
+template <class L, int OFFSET>
+static inline typename L::V step( typename L::V v, typename L::V wrap )
+{
+    return L::and_( L::template shift<OFFSET>( v ), wrap );
+}
+
+/// <summary>
+/// Kogge-Stone occluded fill, returning the squares attacked in one direction (including the first blocker)
+/// </summary>
+template <class L, int OFFSET>
+static inline typename L::V fill( typename L::V sliders, typename L::V empty )
+{
+    const typename L::V wrap = L::set1( wrapMask( OFFSET ) );
+
+    empty = L::and_( empty, wrap );
+
+    sliders = L::or_( sliders, L::and_( empty, L::template shift<OFFSET>( sliders ) ) );
+    empty = L::and_( empty, L::template shift<OFFSET>( empty ) );
+    sliders = L::or_( sliders, L::and_( empty, L::template shift<OFFSET * 2>( sliders ) ) );
+    empty = L::and_( empty, L::template shift<OFFSET * 2>( empty ) );
+    sliders = L::or_( sliders, L::and_( empty, L::template shift<OFFSET * 4>( sliders ) ) );
+
+    return L::and_( L::template shift<OFFSET>( sliders ), wrap );
+}
+
+/// <summary>
+/// Everything about our king in one direction - whether it is in check along that ray and which of our pieces are pinned on it
+/// </summary>
+template <class L, int OFFSET>
+static inline void kingRay( typename L::V king, typename L::V sliders, typename L::V own, typename L::V empty,
+                            typename L::V& checkers, typename L::V& checkMask, typename L::V& pinned )
+{
+    const typename L::V ray = fill<L, OFFSET>( king, empty );
+    const typename L::V checker = L::and_( ray, sliders );
+
+    // The ray from the king up to and including a checker is where a piece can capture or block
+    checkers = L::or_( checkers, checker );
+    checkMask = L::or_( checkMask, L::andNot( L::isZero( checker ), ray ) );
+
+    // An own piece that is the first thing seen from the king and from an enemy slider the other way is pinned
+    pinned = L::or_( pinned, L::and_( L::and_( ray, fill<L, -OFFSET>( sliders, empty ) ), own ) );
+}
+
+/// <summary>
+/// Count the moves of sliders in one direction - rays in the same direction never overlap as each
+/// stops at the first piece it meets, so one popcount counts the moves of every slider at once
+/// </summary>
+template <class L, int OFFSET>
+static inline typename L::V sliderMoves( typename L::V sliders, typename L::V empty, typename L::V targets )
+{
+    return L::popcount( L::and_( fill<L, OFFSET>( sliders, empty ), targets ) );
+}
+
+template <class L, int OFFSET>
+static inline typename L::V knightMoves( typename L::V knights, typename L::V targets )
+{
+    return L::popcount( L::and_( step<L, OFFSET>( knights, L::set1( wrapMask( OFFSET ) ) ), targets ) );
+}
+
+template <class L>
+static inline typename L::V knightAttacks( typename L::V knights )
+{
+    typename L::V attacks = step<L, 17>( knights, L::set1( wrapMask( 17 ) ) );
+    attacks = L::or_( attacks, step<L, 15>( knights, L::set1( wrapMask( 15 ) ) ) );
+    attacks = L::or_( attacks, step<L, 10>( knights, L::set1( wrapMask( 10 ) ) ) );
+    attacks = L::or_( attacks, step<L, 6>( knights, L::set1( wrapMask( 6 ) ) ) );
+    attacks = L::or_( attacks, step<L, -6>( knights, L::set1( wrapMask( -6 ) ) ) );
+    attacks = L::or_( attacks, step<L, -10>( knights, L::set1( wrapMask( -10 ) ) ) );
+    attacks = L::or_( attacks, step<L, -15>( knights, L::set1( wrapMask( -15 ) ) ) );
+    return L::or_( attacks, step<L, -17>( knights, L::set1( wrapMask( -17 ) ) ) );
+}
+
+template <class L>
+static inline typename L::V kingAttacks( typename L::V king )
+{
+    const typename L::V notA = L::set1( wrapMask( 1 ) );
+    const typename L::V notH = L::set1( wrapMask( -1 ) );
+
+    // Sideways, then that row up and down
+    const typename L::V row = L::or_( king, L::or_( step<L, 1>( king, notA ), step<L, -1>( king, notH ) ) );
+
+    return L::or_( L::xor_( row, king ), L::or_( L::template shift<8>( row ), L::template shift<-8>( row ) ) );
+}
+
+template <class Lanes>
+void BatchCounter::countLanes( const Batch& batch, size_t start, unsigned long long* counts )
+{
+    typedef Lanes L;
+    typedef typename L::V V;
+
+    const V all = L::set1( ~0ull );
+    const V notA = L::set1( wrapMask( 1 ) );
+    const V notH = L::set1( wrapMask( -1 ) );
+
+    const V own = L::load( &batch.own[ start ] );
+    const V opponent = L::load( &batch.opponent[ start ] );
+    const V occupied = L::or_( own, opponent );
+    const V empty = L::xor_( occupied, all );
+
+    const V pawns = L::load( &batch.pieces[ 0 ][ start ] );
+    const V knights = L::load( &batch.pieces[ 1 ][ start ] );
+    const V bishops = L::load( &batch.pieces[ 2 ][ start ] );
+    const V rooks = L::load( &batch.pieces[ 3 ][ start ] );
+    const V queens = L::load( &batch.pieces[ 4 ][ start ] );
+    const V kings = L::load( &batch.pieces[ 5 ][ start ] );
+
+    const V king = L::and_( kings, own );
+    const V ownPawns = L::and_( pawns, own );
+    const V ownKnights = L::and_( knights, own );
+    const V ownDiagonal = L::and_( L::or_( bishops, queens ), own );
+    const V ownOrthogonal = L::and_( L::or_( rooks, queens ), own );
+
+    const V opponentPawns = L::and_( pawns, opponent );
+    const V opponentDiagonal = L::and_( L::or_( bishops, queens ), opponent );
+    const V opponentOrthogonal = L::and_( L::or_( rooks, queens ), opponent );
+
+    // Everything the opponent attacks, looking through our king so that it can't step back along a checking ray
+    const V emptyWithoutKing = L::or_( empty, king );
+
+    V opponentAttacks = L::or_( step<L, -9>( opponentPawns, notH ), step<L, -7>( opponentPawns, notA ) );
+    opponentAttacks = L::or_( opponentAttacks, knightAttacks<L>( L::and_( knights, opponent ) ) );
+    opponentAttacks = L::or_( opponentAttacks, kingAttacks<L>( L::and_( kings, opponent ) ) );
+    opponentAttacks = L::or_( opponentAttacks, fill<L, 8>( opponentOrthogonal, emptyWithoutKing ) );
+    opponentAttacks = L::or_( opponentAttacks, fill<L, -8>( opponentOrthogonal, emptyWithoutKing ) );
+    opponentAttacks = L::or_( opponentAttacks, fill<L, 1>( opponentOrthogonal, emptyWithoutKing ) );
+    opponentAttacks = L::or_( opponentAttacks, fill<L, -1>( opponentOrthogonal, emptyWithoutKing ) );
+    opponentAttacks = L::or_( opponentAttacks, fill<L, 9>( opponentDiagonal, emptyWithoutKing ) );
+    opponentAttacks = L::or_( opponentAttacks, fill<L, -9>( opponentDiagonal, emptyWithoutKing ) );
+    opponentAttacks = L::or_( opponentAttacks, fill<L, 7>( opponentDiagonal, emptyWithoutKing ) );
+    opponentAttacks = L::or_( opponentAttacks, fill<L, -7>( opponentDiagonal, emptyWithoutKing ) );
+
+    // Checks from pawns and knights - the only escape is capturing the checker
+    V checkers = L::and_( L::or_( step<L, 7>( king, notH ), step<L, 9>( king, notA ) ), opponentPawns );
+    checkers = L::or_( checkers, L::and_( knightAttacks<L>( king ), L::and_( knights, opponent ) ) );
+
+    V checkMask = checkers;
+
+    // Checks and pins along each line through the king
+    V pinnedFile = L::zero();
+    V pinnedRank = L::zero();
+    V pinnedDiagonal = L::zero();
+    V pinnedAntiDiagonal = L::zero();
+
+    kingRay<L, 8>( king, opponentOrthogonal, own, empty, checkers, checkMask, pinnedFile );
+    kingRay<L, -8>( king, opponentOrthogonal, own, empty, checkers, checkMask, pinnedFile );
+    kingRay<L, 1>( king, opponentOrthogonal, own, empty, checkers, checkMask, pinnedRank );
+    kingRay<L, -1>( king, opponentOrthogonal, own, empty, checkers, checkMask, pinnedRank );
+    kingRay<L, 9>( king, opponentDiagonal, own, empty, checkers, checkMask, pinnedDiagonal );
+    kingRay<L, -9>( king, opponentDiagonal, own, empty, checkers, checkMask, pinnedDiagonal );
+    kingRay<L, 7>( king, opponentDiagonal, own, empty, checkers, checkMask, pinnedAntiDiagonal );
+    kingRay<L, -7>( king, opponentDiagonal, own, empty, checkers, checkMask, pinnedAntiDiagonal );
+
+    // Not in check - anywhere. In check once - capture or block. Double check - only the king can move
+    const V checkerCount = L::popcount( checkers );
+    const V notInCheck = L::isZero( checkerCount );
+    const V blockMask = L::or_( notInCheck, L::and_( L::isEqual( checkerCount, L::set1( 1 ) ), checkMask ) );
+
+    const V targets = L::andNot( own, blockMask );
+    const V notPinned = L::xor_( L::or_( L::or_( pinnedFile, pinnedRank ), L::or_( pinnedDiagonal, pinnedAntiDiagonal ) ), all );
+
+    // Knights - a pinned knight can never move
+    const V freeKnights = L::and_( ownKnights, notPinned );
+
+    V count = knightMoves<L, 17>( freeKnights, targets );
+    count = L::add( count, knightMoves<L, 15>( freeKnights, targets ) );
+    count = L::add( count, knightMoves<L, 10>( freeKnights, targets ) );
+    count = L::add( count, knightMoves<L, 6>( freeKnights, targets ) );
+    count = L::add( count, knightMoves<L, -6>( freeKnights, targets ) );
+    count = L::add( count, knightMoves<L, -10>( freeKnights, targets ) );
+    count = L::add( count, knightMoves<L, -15>( freeKnights, targets ) );
+    count = L::add( count, knightMoves<L, -17>( freeKnights, targets ) );
+
+    // Sliders - a pinned slider can still move along the line it is pinned on
+    const V fileMovers = L::and_( ownOrthogonal, L::or_( notPinned, pinnedFile ) );
+    const V rankMovers = L::and_( ownOrthogonal, L::or_( notPinned, pinnedRank ) );
+    const V diagonalMovers = L::and_( ownDiagonal, L::or_( notPinned, pinnedDiagonal ) );
+    const V antiDiagonalMovers = L::and_( ownDiagonal, L::or_( notPinned, pinnedAntiDiagonal ) );
+
+    count = L::add( count, sliderMoves<L, 8>( fileMovers, empty, targets ) );
+    count = L::add( count, sliderMoves<L, -8>( fileMovers, empty, targets ) );
+    count = L::add( count, sliderMoves<L, 1>( rankMovers, empty, targets ) );
+    count = L::add( count, sliderMoves<L, -1>( rankMovers, empty, targets ) );
+    count = L::add( count, sliderMoves<L, 9>( diagonalMovers, empty, targets ) );
+    count = L::add( count, sliderMoves<L, -9>( diagonalMovers, empty, targets ) );
+    count = L::add( count, sliderMoves<L, 7>( antiDiagonalMovers, empty, targets ) );
+    count = L::add( count, sliderMoves<L, -7>( antiDiagonalMovers, empty, targets ) );
+
+    // Pawns - pushes and captures, with moves onto the last rank counting once for each promotion piece
+    const V promotionRank = L::set1( BitBoard::getRankMask( 7 ) );
+
+    const V singlePushes = L::and_( L::template shift<8>( L::and_( ownPawns, L::or_( notPinned, pinnedFile ) ) ), empty );
+    const V doublePushes = L::and_( L::and_( L::template shift<8>( singlePushes ), empty ), L::set1( BitBoard::getRankMask( 3 ) ) );
+    const V westCaptures = L::and_( step<L, 7>( L::and_( ownPawns, L::or_( notPinned, pinnedAntiDiagonal ) ), notH ), opponent );
+    const V eastCaptures = L::and_( step<L, 9>( L::and_( ownPawns, L::or_( notPinned, pinnedDiagonal ) ), notA ), opponent );
+
+    const V pushTargets = L::and_( singlePushes, blockMask );
+    const V westTargets = L::and_( westCaptures, blockMask );
+    const V eastTargets = L::and_( eastCaptures, blockMask );
+
+    count = L::add( count, L::popcount( L::andNot( promotionRank, pushTargets ) ) );
+    count = L::add( count, L::popcount( L::and_( doublePushes, blockMask ) ) );
+    count = L::add( count, L::popcount( L::andNot( promotionRank, westTargets ) ) );
+    count = L::add( count, L::popcount( L::andNot( promotionRank, eastTargets ) ) );
+
+    V promotions = L::popcount( L::and_( promotionRank, pushTargets ) );
+    promotions = L::add( promotions, L::popcount( L::and_( promotionRank, westTargets ) ) );
+    promotions = L::add( promotions, L::popcount( L::and_( promotionRank, eastTargets ) ) );
+    promotions = L::add( promotions, promotions );
+    count = L::add( count, L::add( promotions, promotions ) );
+
+    // King
+    count = L::add( count, L::popcount( L::andNot( opponentAttacks, L::andNot( own, kingAttacks<L>( king ) ) ) ) );
+
+    // Castling - not out of, through or into check, with the squares between king and rook empty
+    const V castlingRights = L::load( &batch.castlingRights[ start ] );
+    const V one = L::set1( 1 );
+
+    const V kingside = L::and_( L::andNot( L::isZero( L::and_( castlingRights, L::set1( Board::WHITE_KINGSIDE ) ) ), notInCheck ),
+                                L::and_( L::isZero( L::and_( occupied, L::set1( BitBoard::getWhiteKingsideCastlingMask() ) ) ),
+                                         L::isZero( L::and_( opponentAttacks, L::set1( WHITE_KINGSIDE_PATH ) ) ) ) );
+    const V queenside = L::and_( L::andNot( L::isZero( L::and_( castlingRights, L::set1( Board::WHITE_QUEENSIDE ) ) ), notInCheck ),
+                                 L::and_( L::isZero( L::and_( occupied, L::set1( BitBoard::getWhiteQueensideCastlingMask() ) ) ),
+                                          L::isZero( L::and_( opponentAttacks, L::set1( WHITE_QUEENSIDE_PATH ) ) ) ) );
+
+    count = L::add( count, L::add( L::and_( kingside, one ), L::and_( queenside, one ) ) );
+
+    L::store( counts, count );
+
+    // En passant is rare and awkward to do set-wise (the capturing and captured pawns both leave the rank), so do it per position
+    for ( size_t lane = 0; lane < L::WIDTH; lane++ )
+    {
+        if ( batch.enPassantSquare[ start + lane ] != Board::NO_EN_PASSANT )
+        {
+            counts[ lane ] += countEnPassantMoves( batch, start + lane );
+        }
+    }
+}
+
+unsigned long long BatchCounter::countEnPassantMoves( const Batch& batch, size_t index )
+{
+    const unsigned long long own = batch.own[ index ];
+    const unsigned long long opponent = batch.opponent[ index ];
+    const unsigned long long king = batch.pieces[ 5 ][ index ] & own;
+
+    const unsigned long long epBit = 1ull << batch.enPassantSquare[ index ];
+    const unsigned long long capturedBit = epBit >> 8;
+
+    // Our pawns that attack the ep square are on the squares a black pawn on the ep square would attack
+    unsigned long long capturers = batch.pieces[ 0 ][ index ] & own & BitBoard::getBlackPawnAttackMoveMask( batch.enPassantSquare[ index ] );
+
+    unsigned long long count = 0;
+    unsigned long from;
+
+    while ( _BitScanForward64( &from, capturers ) )
+    {
+        capturers ^= 1ull << from;
+
+        // Make the capture on the occupancy and see if the king is attacked afterwards
+        const unsigned long long remaining = opponent ^ capturedBit;
+        const unsigned long long occupied = ( own | opponent ) ^ ( 1ull << from ) ^ epBit ^ capturedBit;
+
+        const unsigned long long attacks = AttackMap::getAttacks( batch.pieces[ 0 ][ index ] & remaining,
+                                                                  batch.pieces[ 1 ][ index ] & remaining,
+                                                                  ( batch.pieces[ 2 ][ index ] | batch.pieces[ 4 ][ index ] ) & remaining,
+                                                                  ( batch.pieces[ 3 ][ index ] | batch.pieces[ 4 ][ index ] ) & remaining,
+                                                                  batch.pieces[ 5 ][ index ] & remaining,
+                                                                  occupied,
+                                                                  false );
+
+        if ( !( attacks & king ) )
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+void BatchCounter::initialize( bool allowVectorized )
+{
+    if ( allowVectorized && isAVX512Supported() )
+    {
+        kernel = &countLanes<AVX512Lanes>;
+        width = AVX512Lanes::WIDTH;
+        implementationName = "AVX-512";
+    }
+    else if ( allowVectorized && AttackMap::isAVX2Supported() )
+    {
+        kernel = &countLanes<AVX2Lanes>;
+        width = AVX2Lanes::WIDTH;
+        implementationName = "AVX2";
+    }
+    else
+    {
+        kernel = &countLanes<ScalarLanes>;
+        width = ScalarLanes::WIDTH;
+        implementationName = "scalar";
+    }
+}
+
+bool BatchCounter::isAVX512Supported()
+{
+    int info[ 4 ];
+
+    if ( !AttackMap::isAVX2Supported() )
+    {
+        return false;
+    }
+
+    // The OS has to be saving the opmask and ZMM registers too (XCR0 bits 5 to 7)
+    if ( ( _xgetbv( 0 ) & 0b11100000 ) != 0b11100000 )
+    {
+        return false;
+    }
+
+    // AVX512F and AVX512_VPOPCNTDQ
+    __cpuidex( info, 7, 0 );
+    return ( info[ 1 ] & ( 1 << 16 ) ) != 0 && ( info[ 2 ] & ( 1 << 14 ) ) != 0;
+}
+
+const char* BatchCounter::getImplementationName()
+{
+    return implementationName;
+}
+
+void BatchCounter::countMoves( const Batch& batch, unsigned long long* counts )
+{
+    size_t index = 0;
+
+    // Full sets of lanes, then any left over one at a time
+    for ( ; index + width <= batch.size(); index += width )
+    {
+        kernel( batch, index, counts + index );
+    }
+
+    for ( ; index < batch.size(); index++ )
+    {
+        countLanes<ScalarLanes>( batch, index, counts + index );
+    }
+}
+
+bool BatchCounter::countMoves( const Batch& batch, int depth, unsigned long long* counts )
+{
+    if ( depth == 1 )
+    {
+        countMoves( batch, counts );
+        return true;
+    }
+
+    if ( depth != 2 )
+    {
+        return false;
+    }
+
+    // Expand every position and count all the children in one batch, remembering which parent each came from
+    Batch children;
+    std::vector<size_t> parents;
+    std::vector<Move> moves;
+    moves.reserve( 256 );
+
+    for ( size_t index = 0; index < batch.size(); index++ )
+    {
+        Board board = toBoard( batch, index );
+
+        moves.clear();
+        board.getMoves( moves );
+
+        for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+        {
+            Board::State undo = board.makeMove( *it );
+
+            children.add( board );
+            parents.push_back( index );
+
+            board.unmakeMove( undo );
+        }
+
+        counts[ index ] = 0;
+    }
+
+    std::vector<unsigned long long> childCounts( children.size() );
+    countMoves( children, childCounts.data() );
+
+    for ( size_t index = 0; index < children.size(); index++ )
+    {
+        counts[ parents[ index ] ] += childCounts[ index ];
+    }
+
+    return true;
+}
+
+Board BatchCounter::toBoard( const Batch& batch, size_t index )
+{
+    std::array<unsigned long long, 6> pieces;
+    for ( size_t loop = 0; loop < pieces.size(); loop++ )
+    {
+        pieces[ loop ] = batch.pieces[ loop ][ index ];
+    }
+
+    // Batch positions are always white to move - the clocks don't matter for counting
+    return Board( pieces,
+                  { batch.own[ index ], batch.opponent[ index ] },
+                  true,
+                  static_cast<unsigned char>( batch.castlingRights[ index ] ),
+                  batch.enPassantSquare[ index ],
+                  0,
+                  1 );
+}
+
+void BatchCounter::Batch::add( const Board& board )
+{
+    if ( board.whiteToMove )
+    {
+        for ( size_t loop = 0; loop < 6; loop++ )
+        {
+            pieces[ loop ].push_back( board.pieces[ loop ] );
+        }
+
+        own.push_back( board.colors[ Board::WHITE ] );
+        opponent.push_back( board.colors[ Board::BLACK ] );
+        castlingRights.push_back( board.castlingRights );
+        enPassantSquare.push_back( board.enPassantSquare );
+    }
+    else
+    {
+        // Mirror the board top to bottom - byte swapping swaps the ranks - and swap the colors so that white is to move
+        for ( size_t loop = 0; loop < 6; loop++ )
+        {
+            pieces[ loop ].push_back( _byteswap_uint64( board.pieces[ loop ] ) );
+        }
+
+        own.push_back( _byteswap_uint64( board.colors[ Board::BLACK ] ) );
+        opponent.push_back( _byteswap_uint64( board.colors[ Board::WHITE ] ) );
+        castlingRights.push_back( ( ( board.castlingRights & 0b0011 ) << 2 ) | ( ( board.castlingRights & 0b1100 ) >> 2 ) );
+        enPassantSquare.push_back( board.enPassantSquare == Board::NO_EN_PASSANT ? Board::NO_EN_PASSANT : board.enPassantSquare ^ 56 );
+    }
+}
+
+void BatchCounter::Batch::clear()
+{
+    for ( size_t loop = 0; loop < 6; loop++ )
+    {
+        pieces[ loop ].clear();
+    }
+
+    own.clear();
+    opponent.clear();
+    castlingRights.clear();
+    enPassantSquare.clear();
+}
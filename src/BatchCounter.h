@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+class Board;
+
+/// <summary>
+/// Counts legal moves for many independent positions at once, one position per SIMD lane (8 with AVX-512,
+/// 4 with AVX2, or 1 at a time when neither is available).
+/// Moves are counted set-wise, direction by direction, rather than being generated, so there is no per-piece
+/// branching to stop the lanes running together
+/// </summary>
+class BatchCounter
+{
+public:
+    /// <summary>
+    /// Positions in structure-of-arrays form. Positions with black to move are stored mirrored (ranks and colors
+    /// swapped) so that every lane has white to move, which has the same move count
+    /// </summary>
+    class Batch
+    {
+    private:
+        friend class BatchCounter;
+
+        std::vector<unsigned long long> pieces[ 6 ];
+        std::vector<unsigned long long> own;
+        std::vector<unsigned long long> opponent;
+        std::vector<unsigned long long> castlingRights;
+        std::vector<unsigned char> enPassantSquare;
+
+    public:
+        void add( const Board& board );
+
+        void clear();
+
+        size_t size() const
+        {
+            return own.size();
+        }
+    };
+
+    /// <summary>
+    /// Pick the widest implementation this CPU supports
+    /// </summary>
+    /// <param name="allowVectorized">false to force the scalar implementation</param>
+    static void initialize( bool allowVectorized = true );
+
+    /// <summary>
+    /// The name of the implementation in use - "AVX-512", "AVX2" or "scalar"
+    /// </summary>
+    static const char* getImplementationName();
+
+    /// <summary>
+    /// Count the legal moves (depth 1) for every position in the batch
+    /// </summary>
+    /// <param name="batch">the positions</param>
+    /// <param name="counts">receives one count per position</param>
+    static void countMoves( const Batch& batch, unsigned long long* counts );
+
+    /// <summary>
+    /// Count the leaf nodes at depth 1 or 2 for every position in the batch. Depth 2 expands each position
+    /// and counts all the children as another batch
+    /// </summary>
+    /// <param name="batch">the positions</param>
+    /// <param name="depth">1 or 2</param>
+    /// <param name="counts">receives one count per position</param>
+    /// <returns><code>false</code> if the depth is not supported</returns>
+    static bool countMoves( const Batch& batch, int depth, unsigned long long* counts );
+
+private:
+    typedef void ( *Kernel )( const Batch& batch, size_t start, unsigned long long* counts );
+
+    static Kernel kernel;
+    static size_t width;
+    static const char* implementationName;
+
+    static bool isAVX2Supported();
+    static bool isAVX512Supported();
+
+    static unsigned long long countEnPassantMoves( const Batch& batch, size_t index );
+
+    /// <summary>
+    /// Count the moves for the positions starting at start, as many as fit in the lanes
+    /// </summary>
+    template <class Lanes>
+    static void countLanes( const Batch& batch, size_t start, unsigned long long* counts );
+
+    static Board toBoard( const Batch& batch, size_t index );
+};
@@ -5,30 +5,46 @@ class BitBoard
 private:
     static unsigned short RANKFILE_MASK;
 
-    // Masks for sliders
-    static unsigned long long northMoves[ 64 ];
-    static unsigned long long southMoves[ 64 ];
-   
-    static unsigned long long eastMoves[ 64 ];
-    static unsigned long long westMoves[ 64 ];
+    /// <summary>
+    /// The slider masks for one square, together in one cache line, so that generating a queen's moves reads one
+    /// line rather than one from each of eight separate arrays
+    /// </summary>
+    struct alignas( 64 ) SliderMasks
+    {
+        unsigned long long northMoves;
+        unsigned long long southMoves;
+
+        unsigned long long eastMoves;
+        unsigned long long westMoves;
+
+        unsigned long long northEastMoves;
+        unsigned long long southEastMoves;
+
+        unsigned long long northWestMoves;
+        unsigned long long southWestMoves;
+    };
 
-    static unsigned long long northEastMoves[ 64 ];
-    static unsigned long long southEastMoves[ 64 ];
+    /// <summary>
+    /// The knight, king and pawn attack masks for one square, half a cache line, so that an attack test on a square
+    /// reads one line for all of them
+    /// </summary>
+    struct alignas( 32 ) LeaperMasks
+    {
+        unsigned long long knightMoves;
+        unsigned long long kingMoves;
+
+        unsigned long long pawnMovesAttackWhite;
+        unsigned long long pawnMovesAttackBlack;
+    };
 
-    static unsigned long long northWestMoves[ 64 ];
-    static unsigned long long southWestMoves[ 64 ];
+    static SliderMasks sliderMasks[ 64 ];
+    static LeaperMasks leaperMasks[ 64 ];
 
-    // Masks for non-sliders
+    // Pawn pushes, which the set-wise pawn generator doesn't look up
     static unsigned long long pawnMovesNormalWhite[ 64 ];
     static unsigned long long pawnMovesNormalBlack[ 64 ];
     static unsigned long long pawnMovesExtendedWhite[ 64 ];
     static unsigned long long pawnMovesExtendedBlack[ 64 ];
-    static unsigned long long pawnMovesAttackWhite[ 64 ];
-    static unsigned long long pawnMovesAttackBlack[ 64 ];
-
-    static unsigned long long knightMoves[ 64 ];
-
-    static unsigned long long kingMoves[ 64 ];
 
     // Other masks
 
@@ -37,6 +53,9 @@ private:
     static unsigned long long blackKingsideCastlingMask;
     static unsigned long long blackQueensideCastlingMask;
 
+    static unsigned long long rankMasks[ 8 ];
+    static unsigned long long fileMasks[ 8 ];
+
     // Helper methods
 
     static unsigned long long createNorthMask( const unsigned short square )
@@ -234,62 +253,62 @@ public:
 
     inline static unsigned long long getWhitePawnAttackMoveMask( const unsigned long index )
     {
-        return pawnMovesAttackWhite[ index ];
+        return leaperMasks[ index ].pawnMovesAttackWhite;
     }
 
     inline static unsigned long long getBlackPawnAttackMoveMask( const unsigned long index )
     {
-        return pawnMovesAttackBlack[ index ];
+        return leaperMasks[ index ].pawnMovesAttackBlack;
     }
 
     inline static unsigned long long getKnightMoveMask( unsigned long index )
     {
-        return knightMoves[ index ];
+        return leaperMasks[ index ].knightMoves;
     }
 
     inline static unsigned long long getKingMoveMask( const unsigned long index )
     {
-        return kingMoves[ index ];
+        return leaperMasks[ index ].kingMoves;
     }
 
     inline static unsigned long long getNorthMoveMask( const unsigned long index )
     {
-        return northMoves[ index ];
+        return sliderMasks[ index ].northMoves;
     }
 
     inline static unsigned long long getSouthMoveMask( const unsigned long index )
     {
-        return southMoves[ index ];
+        return sliderMasks[ index ].southMoves;
     }
 
     inline static unsigned long long getEastMoveMask( const unsigned long index )
     {
-        return eastMoves[ index ];
+        return sliderMasks[ index ].eastMoves;
     }
 
     inline static unsigned long long getWestMoveMask( const unsigned long index )
     {
-        return westMoves[ index ];
+        return sliderMasks[ index ].westMoves;
     }
 
     inline static unsigned long long getNorthWestMoveMask( const unsigned long index )
     {
-        return northWestMoves[ index ];
+        return sliderMasks[ index ].northWestMoves;
     }
 
     inline static unsigned long long getSouthEastMoveMask( const unsigned long index )
     {
-        return southEastMoves[ index ];
+        return sliderMasks[ index ].southEastMoves;
     }
 
     inline static unsigned long long getNorthEastMoveMask( const unsigned long index )
     {
-        return northEastMoves[ index ];
+        return sliderMasks[ index ].northEastMoves;
     }
 
     inline static unsigned long long getSouthWestMoveMask( const unsigned long index )
     {
-        return southWestMoves[ index ];
+        return sliderMasks[ index ].southWestMoves;
     }
 
     inline static unsigned long long getWhiteKingsideCastlingMask()
@@ -311,5 +330,15 @@ public:
     {
         return blackQueensideCastlingMask;
     }
+
+    inline static unsigned long long getRankMask( const unsigned short rank )
+    {
+        return rankMasks[ rank ];
+    }
+
+    inline static unsigned long long getFileMask( const unsigned short file )
+    {
+        return fileMasks[ file ];
+    }
 };
 
@@ -4,14 +4,15 @@
 #include <iostream>
 #include <sstream>
 
+#include "AttackMap.h"
 #include "BitBoard.h"
+#include "Zobrist.h"
 
-// Indices into bitboards
-const unsigned short Board::EMPTY = 0;
-const unsigned short Board::WHITE = 1;
-const unsigned short Board::BLACK = 7;
+// Indices into colors
+const unsigned short Board::WHITE = 0;
+const unsigned short Board::BLACK = 1;
 
-// Needs to be combined with an offset - WHITE or BLACK
+// Indices into pieces
 const unsigned short Board::PAWN = 0;
 const unsigned short Board::KNIGHT = 1;
 const unsigned short Board::BISHOP = 2;
@@ -19,12 +20,36 @@ const unsigned short Board::ROOK = 3;
 const unsigned short Board::QUEEN = 4;
 const unsigned short Board::KING = 5;
 
+const unsigned char Board::WHITE_KINGSIDE  = 0b0001;
+const unsigned char Board::WHITE_QUEENSIDE = 0b0010;
+const unsigned char Board::BLACK_KINGSIDE  = 0b0100;
+const unsigned char Board::BLACK_QUEENSIDE = 0b1000;
+
+const unsigned char Board::NO_EN_PASSANT = 0;
+
+// Moving to or from a king or rook home square loses the associated castling rights
+// (moving from covers the king or rook moving, moving to covers a rook being captured)
+const unsigned char Board::castlingRightsMask[ 64 ] =
+{
+    0b1101, 0b1111, 0b1111, 0b1111, 0b1100, 0b1111, 0b1111, 0b1110, // a1-h1
+    0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111,
+    0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111,
+    0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111,
+    0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111,
+    0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111,
+    0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111, 0b1111,
+    0b0111, 0b1111, 0b1111, 0b1111, 0b0011, 0b1111, 0b1111, 0b1011, // a8-h8
+};
+
+// Pawns, knights and kings are leapers, the rest sliders - each side has a bit for each, White's in the lower one
+const unsigned char Board::staleAttacksMask[ 6 ] = { 0b0001, 0b0001, 0b0100, 0b0100, 0b0100, 0b0001 };
+
 void Board::getMoves( std::vector<Move>& moves )
 {
-    const unsigned short bitboardPieceIndex = whiteToMove ? WHITE : BLACK;
+    const unsigned short color = whiteToMove ? WHITE : BLACK;
 
-    const unsigned long long& blockingPieces = whiteToMove ? whitePieces : blackPieces;
-    const unsigned long long& attackPieces = whiteToMove ? blackPieces : whitePieces;
+    const unsigned long long& blockingPieces = colors[ color ];
+    const unsigned long long& attackPieces = colors[ color ^ 1 ];
     const unsigned long long& accessibleSquares = emptySquares() | attackPieces;
 
     // normal piece logic for all pieces
@@ -34,30 +59,46 @@ void Board::getMoves( std::vector<Move>& moves )
     // TODO move legality test
 
     // Pawn (including ep capture, promotion)
-    getPawnMoves( moves, bitboardPieceIndex + PAWN, accessibleSquares, attackPieces );
+    getPawnMoves( moves, getPieces( color, PAWN ), attackPieces );
 
     // Knight
-    getKnightMoves( moves, bitboardPieceIndex + KNIGHT, accessibleSquares );
+    getKnightMoves( moves, getPieces( color, KNIGHT ), accessibleSquares );
 
     // Bishop + Queen
-    getBishopMoves( moves, bitboardPieceIndex + BISHOP, accessibleSquares, attackPieces, blockingPieces );
+    getBishopMoves( moves, getPieces( color, BISHOP ), accessibleSquares, attackPieces, blockingPieces );
 
     // Rook (including castling flag set) + Queen
-    getRookMoves( moves, bitboardPieceIndex + ROOK, accessibleSquares, attackPieces, blockingPieces );
+    getRookMoves( moves, getPieces( color, ROOK ), accessibleSquares, attackPieces, blockingPieces );
 
     // Queen
-    getQueenMoves( moves, bitboardPieceIndex + QUEEN, accessibleSquares, attackPieces, blockingPieces );
+    getQueenMoves( moves, getPieces( color, QUEEN ), accessibleSquares, attackPieces, blockingPieces );
+
+    updateAttacks( color ^ 1 );
 
-    // King (including castling, castling flag set)
-    getKingMoves( moves, bitboardPieceIndex + KING, accessibleSquares );
+    // Everything the opponent attacks
+    const unsigned long long king = getPieces( color, KING );
+    unsigned long long opponentAttacks = getAttacks( color ^ 1 );
+    const bool inCheck = ( opponentAttacks & king ) != 0;
 
-    // TODO is the king in check after any of these moves?
+    // Out of check, a move can only expose the king if the piece moving is pinned - it has to be on a line out
+    // from the king and be seen by an opponent slider. Only those moves, and ep which takes two pieces off a line,
+    // need to be made to be sure
+    const unsigned long long pinCandidates = AttackMap::getSliderAttacks( king, king, occupiedSquares() ) & sliderAttacks[ color ^ 1 ] & blockingPieces;
+
+    // Is the king in check after any of these moves?
     Board::State state( *this );
     for ( std::vector<Move>::iterator it = moves.begin(); it != moves.end(); )
     {
+        if ( !inCheck && !( pinCandidates & ( 1ull << it->getFrom() ) ) && it->getFlags() != Move::EN_PASSANT_CAPTURE )
+        {
+            it++;
+            continue;
+        }
+
         applyMove( *it );
+        updateAttacks( color ^ 1 );
 
-        if ( isAttacked( bitboards[ bitboardPieceIndex + KING ], !whiteToMove ) )
+        if ( getAttacks( color ^ 1 ) & king )
         {
             it = moves.erase( it );
         }
@@ -68,10 +109,78 @@ void Board::getMoves( std::vector<Move>& moves )
 
         unmakeMove( state );
     }
+
+    // When in check, look through our king so that it can't step back along a checking ray
+    if ( inCheck )
+    {
+        opponentAttacks = getAttacks( color ^ 1, occupiedSquares() ^ king );
+    }
+
+    // King (including castling) - added after the legality test above as these are only generated if already legal
+    getKingMoves( moves, king, accessibleSquares & ~opponentAttacks, opponentAttacks );
+}
+
+unsigned long long Board::getCheckers() const
+{
+    const unsigned short color = whiteToMove ? WHITE : BLACK;
+    const unsigned long long king = getPieces( color, KING );
+
+    // Look out from the king as each kind of piece - whatever of the opponent's is seen that way, sees the king
+    const unsigned long long leapers = ( AttackMap::getLeaperAttacks( king, 0, 0, color == WHITE ) & getPieces( color ^ 1, PAWN ) ) |
+                                       ( AttackMap::getLeaperAttacks( 0, king, 0, color == WHITE ) & getPieces( color ^ 1, KNIGHT ) );
+
+    const unsigned long long diagonals = AttackMap::getSliderAttacks( king, 0, occupiedSquares() ) &
+                                         ( getPieces( color ^ 1, BISHOP ) | getPieces( color ^ 1, QUEEN ) );
+
+    const unsigned long long orthogonals = AttackMap::getSliderAttacks( 0, king, occupiedSquares() ) &
+                                           ( getPieces( color ^ 1, ROOK ) | getPieces( color ^ 1, QUEEN ) );
+
+    return leapers | diagonals | orthogonals;
+}
+
+unsigned long long Board::getAttacks( unsigned short color, unsigned long long occupied ) const
+{
+    return AttackMap::getAttacks( getPieces( color, PAWN ),
+                                  getPieces( color, KNIGHT ),
+                                  getPieces( color, BISHOP ) | getPieces( color, QUEEN ),
+                                  getPieces( color, ROOK ) | getPieces( color, QUEEN ),
+                                  getPieces( color, KING ),
+                                  occupied,
+                                  color == WHITE );
+}
+
+unsigned long long Board::getLeaperAttacks( unsigned short color ) const
+{
+    return AttackMap::getLeaperAttacks( getPieces( color, PAWN ), getPieces( color, KNIGHT ), getPieces( color, KING ), color == WHITE );
+}
+
+void Board::updateSliderAttacks( unsigned short color )
+{
+    sliderAttacks[ color ] = AttackMap::getSliderAttacks( getPieces( color, BISHOP ) | getPieces( color, QUEEN ),
+                                                          getPieces( color, ROOK ) | getPieces( color, QUEEN ),
+                                                          occupiedSquares() );
+}
+
+void Board::updateAttacks( unsigned short color )
+{
+    const unsigned long long occupied = occupiedSquares();
+
+    if ( staleAttacks & staleAttacksBit( color, PAWN ) )
+    {
+        leaperAttacks[ color ] = getLeaperAttacks( color );
+    }
+
+    // A slider's rays also change when a square it attacks is filled or emptied - that includes the blocker at the
+    // end of each ray
+    if ( ( staleAttacks & staleAttacksBit( color, QUEEN ) ) || ( sliderAttacks[ color ] & ( attacksOccupied[ color ] ^ occupied ) ) )
+    {
+        updateSliderAttacks( color );
+    }
+
+    attacksOccupied[ color ] = occupied;
+    staleAttacks &= ~( staleAttacksBit( color, PAWN ) | staleAttacksBit( color, QUEEN ) );
 }
 
-// TODO turn this into two methods - makeMove that creates and returns a state and calls applyMove, which does only that
-// then we can call applyMove multiple times and restore from a single state in for-each-move loops
 Board::State Board::makeMove( const Move& move )
 {
     Board::State state( *this );
@@ -83,130 +192,120 @@ Board::State Board::makeMove( const Move& move )
 
 void Board::applyMove( const Move& move )
 {
-    const unsigned short bitboardPieceIndex = whiteToMove ? WHITE : BLACK;
-    const unsigned short opponentBitboardPieceIndex = whiteToMove ? BLACK : WHITE;
+    const unsigned short color = whiteToMove ? WHITE : BLACK;
+    const unsigned short opponentColor = whiteToMove ? BLACK : WHITE;
 
     const unsigned short from = move.getFrom();
     const unsigned short to = move.getTo();
-    const unsigned long promotion = move.getPromotion();
+    const unsigned short flags = move.getFlags();
 
-    const unsigned long long fromBit = 1ull << move.getFrom();
-    const unsigned long long toBit = 1ull << move.getTo();
+    const unsigned long long fromBit = 1ull << from;
+    const unsigned long long toBit = 1ull << to;
 
-    unsigned short fromPiece = bitboardArrayIndexFromBit( fromBit );
-    unsigned short toPiece = bitboardArrayIndexFromBit( toBit );
+    unsigned short fromPiece = pieceFromBit( fromBit );
 
-    //std::cerr << "Making Move: " << move.toString() << " for " << (char*) ( whiteToMove ? "white" : "black" ) << " with a " << pieceFromBitboardArrayIndex( fromPiece ) << std::endl;
-    
-    // Find which piece is moving and move it, with any required side-effects
-    //  - promotion
-    //  - capture
-    //  - capture through promotion
-    //  - ep capture
-    //  - castling
-    //  - ep flag update
-    //  - castling flag update
-
-    // With a regular move, it is just a case of moving from->to in a single bitboard and then refreshing the other masks
+    //std::cerr << "Making Move: " << move.toString() << " for " << (char*) ( whiteToMove ? "white" : "black" ) << " with a " << letterFromPiece( color, fromPiece ) << std::endl;
 
     // Pick up the piece
-    liftPiece( fromPiece, fromBit );
+    liftPiece( color, fromPiece, fromBit );
+    togglePieceKey( color, fromPiece, from );
+    staleAttacks |= staleAttacksBit( color, fromPiece );
 
-    // Deal with a promotion
-    if ( promotion )
-    {
-        // Place the required piece on the board and handle if this is a capture
-        // The promotion piece in Move is uncolored, so we need to adjust it here
-        placePiece( bitboardPieceIndex + bitboardArrayIndexFromPromotion( promotion ), toBit, toPiece );
-    }
-    else
+    // Only look up what is on the destination square when we know there's something there, and take it off
+    if ( ( flags & Move::CAPTURE_FLAG ) && flags != Move::EN_PASSANT_CAPTURE )
     {
-        // Put the piece down and handle if this is a capture
-        placePiece( fromPiece, toBit, toPiece );
-    }
+        const unsigned short capturedPiece = pieceFromBit( toBit );
 
-    // If this is ep, remove the opponent pawn
-    if ( toBit == enPassantIndex && fromPiece == bitboardPieceIndex + PAWN )
-    {
-        // Remove the enemy pawn from its square one step removed from the ep capture index
-        //bitboards[ opponentBitboardPieceIndex + PAWN ] ^= ( whiteToMove ? toBit >> 8 : toBit << 8 );
-        // Remove the captured pawn
-        liftPiece( opponentBitboardPieceIndex + PAWN, ( whiteToMove ? toBit >> 8 : toBit << 8 ) );
+        liftPiece( opponentColor, capturedPiece, toBit );
+        togglePieceKey( opponentColor, capturedPiece, to );
+        staleAttacks |= staleAttacksBit( opponentColor, capturedPiece );
     }
 
-    // Deal with castling
-    if ( fromPiece == bitboardPieceIndex + KING && abs( from - to ) == 2 )
+    // The generators have already told us what sort of move this is, so just do the side-effects for that type
+    switch ( flags )
     {
-        // Castling - work out which by looking at the "to" - which will be one of c1, g1, c8, g8
-        // remembering that the bits are from a1-h8 but when expressed as a binary number, look reversed
-        // Use this info to move the rook
-        switch( toBit )
-        {
-            case 0b00000100: // c1
-                movePiece( WHITE + ROOK, 0b00000001, 0b0001000 );
-                break;
+        case Move::QUIET:
+        case Move::DOUBLE_PAWN_PUSH:
+        case Move::CAPTURE:
+            // Put the piece down - any captured piece has already been removed
+            placePiece( color, fromPiece, toBit );
+            togglePieceKey( color, fromPiece, to );
+            break;
+
+        case Move::EN_PASSANT_CAPTURE:
+            placePiece( color, fromPiece, toBit );
+            togglePieceKey( color, fromPiece, to );
+
+            // Remove the enemy pawn from its square one step removed from the ep capture index
+            liftPiece( opponentColor, PAWN, ( whiteToMove ? toBit >> 8 : toBit << 8 ) );
+            togglePieceKey( opponentColor, PAWN, whiteToMove ? to - 8 : to + 8 );
+            staleAttacks |= staleAttacksBit( opponentColor, PAWN );
+            break;
+
+        case Move::KINGSIDE_CASTLE:
+            placePiece( color, fromPiece, toBit );
+            togglePieceKey( color, fromPiece, to );
+            togglePieceKey( color, ROOK, to + 1 );
+            togglePieceKey( color, ROOK, to - 1 );
+            staleAttacks |= staleAttacksBit( color, ROOK );
+
+            // Move the rook from h1/h8 to f1/f8
+            if ( whiteToMove )
+            {
+                movePiece( WHITE, ROOK, 0b10000000, 0b00100000 );
+            }
+            else
+            {
+                movePiece( BLACK, ROOK,
+                           0b1000000000000000000000000000000000000000000000000000000000000000,
+                           0b0010000000000000000000000000000000000000000000000000000000000000 );
+            }
+            break;
 
-            case 0b01000000: // g1
-                movePiece( WHITE + ROOK, 0b10000000, 0b00100000 );
-                break;
+        case Move::QUEENSIDE_CASTLE:
+            placePiece( color, fromPiece, toBit );
+            togglePieceKey( color, fromPiece, to );
+            togglePieceKey( color, ROOK, to - 2 );
+            togglePieceKey( color, ROOK, to + 1 );
+            staleAttacks |= staleAttacksBit( color, ROOK );
 
-            case 0b0000010000000000000000000000000000000000000000000000000000000000: // c8
-                movePiece( BLACK + ROOK,
+            // Move the rook from a1/a8 to d1/d8
+            if ( whiteToMove )
+            {
+                movePiece( WHITE, ROOK, 0b00000001, 0b00001000 );
+            }
+            else
+            {
+                movePiece( BLACK, ROOK,
                            0b0000000100000000000000000000000000000000000000000000000000000000,
                            0b0000100000000000000000000000000000000000000000000000000000000000 );
-                break;
-
-            case 0b0100000000000000000000000000000000000000000000000000000000000000: // g8
-                movePiece( BLACK + ROOK, 
-                           0b1000000000000000000000000000000000000000000000000000000000000000, 
-                           0b0010000000000000000000000000000000000000000000000000000000000000 );
-                break;
+            }
+            break;
 
-            default:
-                break;
-        }
+        default:
+            // Promotion, with or without capture
+            // The promotion piece in Move is uncolored, so it takes our color here
+            placePiece( color, pieceFromPromotion( flags ), toBit );
+            togglePieceKey( color, pieceFromPromotion( flags ), to );
+            staleAttacks |= staleAttacksBit( color, pieceFromPromotion( flags ) );
+            break;
     }
 
     // Flag setting
 
     // If a pawn move of two squares, set the ep flag
-    if ( fromPiece == bitboardPieceIndex + PAWN && abs( from - to ) == 16 )
+    if ( flags == Move::DOUBLE_PAWN_PUSH )
     {
-        enPassantIndex = 1ull << (from + ( ( to - from ) / 2 ) );
+        enPassantSquare = static_cast<unsigned char>( ( from + to ) >> 1 );
     }
     else
     {
-        enPassantIndex = 0;
+        enPassantSquare = NO_EN_PASSANT;
     }
 
     // Reset the castling flags based on king or rook movement (including rook capture)
     // Not that these are board-location sensitive, not whose move it is
-    if ( fromPiece == WHITE + KING )
-    {
-        castlingRights[ 0 ] = false;
-        castlingRights[ 1 ] = false;
-    }
-    else if ( fromPiece == BLACK + KING )
-    {
-        castlingRights[ 2 ] = false;
-        castlingRights[ 3 ] = false;
-    }
-    if ( ( fromBit | toBit ) & 0b10000000 )
-    {
-        castlingRights[ 0 ] = false;
-    }
-    if ( ( fromBit | toBit ) & 0b00000001 )
-    {
-        castlingRights[ 1 ] = false;
-    }
-    if ( ( fromBit | toBit ) & 0b1000000000000000000000000000000000000000000000000000000000000000 )
-    {
-        castlingRights[ 2 ] = false;
-    }
-    if ( ( fromBit | toBit ) & 0b0000000100000000000000000000000000000000000000000000000000000000 )
-    {
-        castlingRights[ 3 ] = false;
-    }
+    castlingRights &= castlingRightsMask[ from ] & castlingRightsMask[ to ];
 
     // Complete the setup at the end of this move
 
@@ -218,7 +317,7 @@ void Board::applyMove( const Move& move )
     }
 
     // Counts towards 50 move rule unless a pawn move or a capture
-    if ( fromPiece == bitboardPieceIndex + PAWN || toPiece != EMPTY )
+    if ( fromPiece == PAWN || move.isCapture() )
     {
         halfMoveClock = 0;
     }
@@ -226,11 +325,6 @@ void Board::applyMove( const Move& move )
     {
         halfMoveClock++;
     }
-
-    // Rebuild the final set of masks - hopefully as quick to do it this was as any other
-    // TODO an option is to avoid adjusting empty along the way and make it from these two here
-    whitePieces = bitboards[ WHITE + PAWN ] | bitboards[ WHITE + KNIGHT ] | bitboards[ WHITE + BISHOP ] | bitboards[ WHITE + ROOK ] | bitboards[ WHITE + QUEEN ] | bitboards[ WHITE + KING ];
-    blackPieces = bitboards[ BLACK + PAWN ] | bitboards[ BLACK + KNIGHT ] | bitboards[ BLACK + BISHOP ] | bitboards[ BLACK + ROOK ] | bitboards[ BLACK + QUEEN ] | bitboards[ BLACK + KING ];
 }
 
 void Board::unmakeMove( const Board::State& state )
@@ -283,8 +377,9 @@ Board* Board::createBoard( const std::string& fen )
         }
     }
 
-    // Empty squares and then two sets of bitboards for six pieces each - white and black
-    std::array<unsigned long long, 13> bitboards = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, };
+    // Six piece type bitboards and then one for each color
+    std::array<unsigned long long, 6> pieceBitboards = { 0, 0, 0, 0, 0, 0 };
+    std::array<unsigned long long, 2> colorBitboards = { 0, 0 };
 
     // Unpack FEN board representation
     unsigned long long mask = 1ull << 56;
@@ -305,15 +400,13 @@ Board* Board::createBoard( const std::string& fen )
                 char distance[ 2 ];
                 distance[ 0 ] = *it;
                 distance[ 1 ] = '\0';
-                for ( int index = 0; index < atoi( distance ); index++ )
-                {
-                    bitboards[ 0 ] |= mask;
-                    mask <<= 1;
-                }
+                mask <<= atoi( distance );
             }
             else
             {
-                bitboards[ bitboardArrayIndexFromPiece( *it ) ] |= mask;
+                unsigned short letterIndex = pieceLetterIndex( *it );
+                pieceBitboards[ letterIndex % 6 ] |= mask;
+                colorBitboards[ letterIndex / 6 ] |= mask;
                 mask <<= 1;
             }
         }
@@ -335,58 +428,281 @@ Board* Board::createBoard( const std::string& fen )
             char distance[ 2 ];
             distance[ 0 ] = *it;
             distance[ 1 ] = '\0';
-            for ( int index = 0; index < atoi( distance ); index++ )
-            {
-                bitboards[ 0 ] |= mask;
-                mask <<= 1;
-            }
+            mask <<= atoi( distance );
         }
         else
         {
-            bitboards[ bitboardArrayIndexFromPiece( *it ) ] |= mask;
+            unsigned short letterIndex = pieceLetterIndex( *it );
+            pieceBitboards[ letterIndex % 6 ] |= mask;
+            colorBitboards[ letterIndex / 6 ] |= mask;
             mask <<= 1;
         }
     }
 
     bool whiteToPlay = color == "w";
 
-    size_t castlingIndex = 0;
-    std::array<bool, 4> castlingRights = { false, false, false, false };
+    unsigned char castlingRights = 0;
+
+    for ( std::string::const_iterator it = castling.cbegin(); it != castling.cend(); it++ )
+    {
+        switch ( *it )
+        {
+            case 'K':
+                castlingRights |= WHITE_KINGSIDE;
+                break;
+
+            case 'Q':
+                castlingRights |= WHITE_QUEENSIDE;
+                break;
+
+            case 'k':
+                castlingRights |= BLACK_KINGSIDE;
+                break;
+
+            case 'q':
+                castlingRights |= BLACK_QUEENSIDE;
+                break;
+
+            default:
+                break;
+        }
+    }
 
-    if ( castling[ castlingIndex ] == 'K' )
+    unsigned char ep = NO_EN_PASSANT;
+    if ( enPassant != "-" )
     {
-        castlingRights[ 0 ] = true;
-        castlingIndex++;
+        // The square index of (eg) e3
+        ep = static_cast<unsigned char>( ( ( enPassant[ 1 ] - '1' ) << 3 ) | ( enPassant[ 0 ] - 'a' ) );
+    }
+
+    Board* board = new Board( pieceBitboards,
+                              colorBitboards,
+                              whiteToPlay,
+                              castlingRights,
+                              ep,
+                              atoi( halfMoveClock.c_str() ),
+                              atoi( fullMoveNumber.c_str() ) );
+
+    // Drop any rights the FEN gives for a king or rook that has moved, so that the move generator agrees with the Zobrist key
+    board->castlingRights = board->getEffectiveCastlingRights();
+
+    return board;
+}
+
+void Board::initializePieceKey()
+{
+    pieceKey = 0;
+
+    unsigned long index;
+    for ( unsigned short color = WHITE; color <= BLACK; color++ )
+    {
+        for ( unsigned short piece = PAWN; piece <= KING; piece++ )
+        {
+            unsigned long long mask = getPieces( color, piece );
+
+            while ( _BitScanForward64( &index, mask ) )
+            {
+                mask ^= 1ull << index;
+
+                togglePieceKey( color, piece, index );
+            }
+        }
     }
-    if ( castling[ castlingIndex ] == 'Q' )
+}
+
+unsigned long long Board::getZobristKey() const
+{
+    unsigned long long key = pieceKey ^ Zobrist::getCastlingKey( getEffectiveCastlingRights() );
+
+    if ( isEnPassantCapturable() )
     {
-        castlingRights[ 1 ] = true;
-        castlingIndex++;
+        key ^= Zobrist::getEnPassantKey( enPassantSquare & 7 );
     }
-    if ( castling[ castlingIndex ] == 'k' )
+
+    if ( !whiteToMove )
     {
-        castlingRights[ 2 ] = true;
-        castlingIndex++;
+        key ^= Zobrist::getBlackToMoveKey();
     }
-    if ( castling[ castlingIndex ] == 'q' )
+
+    return key;
+}
+
+unsigned long long Board::getPositionKey()
+{
+    unsigned long long key = getZobristKey();
+
+    if ( isEnPassantCapturable() )
     {
-        castlingRights[ 3 ] = true;
-        castlingIndex++;
+        std::vector<Move> moves;
+        getMoves( moves );
+
+        for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+        {
+            if ( it->getFlags() == Move::EN_PASSANT_CAPTURE )
+            {
+                return key;
+            }
+        }
+
+        // The capturing pawn is pinned, or the king is in check from something the capture doesn't deal with
+        key ^= Zobrist::getEnPassantKey( enPassantSquare & 7 );
     }
 
-    unsigned long long ep = 0;
-    if ( enPassant != "-" )
+    return key;
+}
+
+std::array<unsigned long long, 3> Board::getMirroredPieceKeys() const
+{
+    std::array<unsigned long long, 3> keys = { 0, 0, 0 };
+
+    unsigned long index;
+    for ( unsigned short color = WHITE; color <= BLACK; color++ )
     {
-        // Make this a bitboard thing - the bit at (eg) e3 or 0 for no EP
-        ep = 1ull << ( ( ( enPassant[ 1 ] - '1' ) << 3 ) | ( enPassant[ 0 ] - 'a' ) );
+        for ( unsigned short piece = PAWN; piece <= KING; piece++ )
+        {
+            unsigned long long mask = getPieces( color, piece );
+
+            while ( _BitScanForward64( &index, mask ) )
+            {
+                mask ^= 1ull << index;
+
+                keys[ 0 ] ^= Zobrist::getPieceKey( color ^ 1, piece, index ^ 56 );
+                keys[ 1 ] ^= Zobrist::getPieceKey( color, piece, index ^ 7 );
+                keys[ 2 ] ^= Zobrist::getPieceKey( color ^ 1, piece, index ^ 63 );
+            }
+        }
     }
 
-    return new Board( bitboards,
-                      whiteToPlay,
-                      castlingRights,
-                      ep,
-                      atoi( halfMoveClock.c_str() ),
-                      atoi( fullMoveNumber.c_str() ) );
+    return keys;
+}
+
+unsigned long long Board::getFlippedZobristKey() const
+{
+    return getFlippedZobristKey( getMirroredPieceKeys() );
+}
+
+unsigned long long Board::getFlippedZobristKey( const std::array<unsigned long long, 3>& mirroredPieceKeys ) const
+{
+    // In the mirror white's rights are black's and black's are white's, the ep square is on the same file and the
+    // other side is to move
+    const unsigned char rights = getEffectiveCastlingRights();
+
+    unsigned long long key = mirroredPieceKeys[ 0 ] ^ Zobrist::getCastlingKey( ( ( rights & 0b0011 ) << 2 ) | ( ( rights & 0b1100 ) >> 2 ) );
+
+    if ( isEnPassantCapturable() )
+    {
+        key ^= Zobrist::getEnPassantKey( enPassantSquare & 7 );
+    }
+
+    if ( whiteToMove )
+    {
+        key ^= Zobrist::getBlackToMoveKey();
+    }
+
+    return key;
+}
+
+void Board::getMirroredZobristKeys( unsigned long long& mirroredKey, unsigned long long& flippedMirroredKey ) const
+{
+    getMirroredZobristKeys( getMirroredPieceKeys(), mirroredKey, flippedMirroredKey );
+}
+
+void Board::getMirroredZobristKeys( const std::array<unsigned long long, 3>& mirroredPieceKeys, unsigned long long& mirroredKey, unsigned long long& flippedMirroredKey ) const
+{
+    // Mirroring left to right moves every square to the other end of its rank and the ep square to the mirrored
+    // file. There are no castling rights to mirror, and the color-flipped mirror has the other side to move
+    mirroredKey = mirroredPieceKeys[ 1 ];
+    flippedMirroredKey = mirroredPieceKeys[ 2 ];
+
+    if ( isEnPassantCapturable() )
+    {
+        mirroredKey ^= Zobrist::getEnPassantKey( 7 - ( enPassantSquare & 7 ) );
+        flippedMirroredKey ^= Zobrist::getEnPassantKey( 7 - ( enPassantSquare & 7 ) );
+    }
+
+    if ( whiteToMove )
+    {
+        flippedMirroredKey ^= Zobrist::getBlackToMoveKey();
+    }
+    else
+    {
+        mirroredKey ^= Zobrist::getBlackToMoveKey();
+    }
+}
+
+unsigned long long Board::getSymmetricZobristKey() const
+{
+    // One pass over the pieces for all the mirrors - this is only asked for by -symmetric lookups
+    const std::array<unsigned long long, 3> mirroredPieceKeys = getMirroredPieceKeys();
+
+    const unsigned long long key = getZobristKey();
+    const unsigned long long flippedKey = getFlippedZobristKey( mirroredPieceKeys );
+
+    unsigned long long symmetricKey = key < flippedKey ? key : flippedKey;
+
+    // Castling is the only rule that tells the king's side from the queen's side, so once the rights are gone a
+    // position and its left-right mirror have the same counts
+    if ( getEffectiveCastlingRights() == 0 )
+    {
+        unsigned long long mirroredKey;
+        unsigned long long flippedMirroredKey;
+        getMirroredZobristKeys( mirroredPieceKeys, mirroredKey, flippedMirroredKey );
+
+        symmetricKey = mirroredKey < symmetricKey ? mirroredKey : symmetricKey;
+        symmetricKey = flippedMirroredKey < symmetricKey ? flippedMirroredKey : symmetricKey;
+    }
+
+    return symmetricKey;
+}
+
+unsigned char Board::getEffectiveCastlingRights() const
+{
+    unsigned char rights = castlingRights;
+
+    if ( !( getPieces( WHITE, KING ) & 0b00010000 ) )
+    {
+        rights &= ~( WHITE_KINGSIDE | WHITE_QUEENSIDE );
+    }
+
+    if ( !( getPieces( WHITE, ROOK ) & 0b10000000 ) )
+    {
+        rights &= ~WHITE_KINGSIDE;
+    }
+
+    if ( !( getPieces( WHITE, ROOK ) & 0b00000001 ) )
+    {
+        rights &= ~WHITE_QUEENSIDE;
+    }
+
+    if ( !( getPieces( BLACK, KING ) & 0b0001000000000000000000000000000000000000000000000000000000000000 ) )
+    {
+        rights &= ~( BLACK_KINGSIDE | BLACK_QUEENSIDE );
+    }
+
+    if ( !( getPieces( BLACK, ROOK ) & 0b1000000000000000000000000000000000000000000000000000000000000000 ) )
+    {
+        rights &= ~BLACK_KINGSIDE;
+    }
+
+    if ( !( getPieces( BLACK, ROOK ) & 0b0000000100000000000000000000000000000000000000000000000000000000 ) )
+    {
+        rights &= ~BLACK_QUEENSIDE;
+    }
+
+    return rights;
+}
+
+bool Board::isEnPassantCapturable() const
+{
+    if ( enPassantSquare == NO_EN_PASSANT )
+    {
+        return false;
+    }
+
+    // Look from the ep square with the other color's pawn attacks to find where a capturing pawn would have to be
+    const unsigned long long capturingSquares = whiteToMove ? BitBoard::getBlackPawnAttackMoveMask( enPassantSquare ) : BitBoard::getWhitePawnAttackMoveMask( enPassantSquare );
+
+    return ( capturingSquares & getPieces( whiteToMove ? WHITE : BLACK, PAWN ) ) != 0;
 }
 
 std::string Board::toString() const
@@ -410,7 +726,7 @@ std::string Board::toString() const
                 fen << counter;
                 counter = 0;
             }
-            fen << pieceFromBitboardArrayIndex( bitboardArrayIndexFromBit( mask ) );
+            fen << letterFromPiece( colors[ WHITE ] & mask ? WHITE : BLACK, pieceFromBit( mask ) );
         }
         mask <<= 1;
         file++;
@@ -444,33 +760,32 @@ std::string Board::toString() const
     fen << ( whiteToMove ? "w" : "b" ) << " ";
 
     // Castling Rights
-    if ( castlingRights[ 0 ] )
+    if ( castlingRights & WHITE_KINGSIDE )
     {
         fen << "K";
     }
-    if ( castlingRights[ 1 ] )
+    if ( castlingRights & WHITE_QUEENSIDE )
     {
         fen << "Q";
     }
-    if ( castlingRights[ 2 ] )
+    if ( castlingRights & BLACK_KINGSIDE )
     {
         fen << "k";
     }
-    if ( castlingRights[ 3 ] )
+    if ( castlingRights & BLACK_QUEENSIDE )
     {
         fen << "q";
     }
-    if ( !( castlingRights[ 0 ] || castlingRights[ 1 ] || castlingRights[ 2 ] || castlingRights[ 3 ] ) )
+    if ( !castlingRights )
     {
         fen << "-";
     }
     fen << " ";
 
     // En-Passant
-    unsigned long index;
-    if ( _BitScanForward64( &index, enPassantIndex ) )
+    if ( enPassantSquare != NO_EN_PASSANT )
     {
-        fen << (char) ( ( index & 7 ) + 'a' ) << (char) ( ( ( index >> 3 ) & 7 ) + '1' );
+        fen << (char) ( ( enPassantSquare & 7 ) + 'a' ) << (char) ( ( ( enPassantSquare >> 3 ) & 7 ) + '1' );
     }
     else
     {
@@ -492,12 +807,11 @@ bool Board::isEmpty( unsigned long long bit ) const
     return emptySquares() & bit;
 }
 
-unsigned short Board::bitboardArrayIndexFromBit( unsigned long long bit ) const
+unsigned short Board::pieceFromBit( unsigned long long bit ) const
 {
-    // This includes empty squares
-    for ( unsigned short loop = 0; loop < bitboards.size(); loop++ )
+    for ( unsigned short loop = 0; loop < pieces.size(); loop++ )
     {
-        if ( bitboards[ loop ] & bit )
+        if ( pieces[ loop ] & bit )
         {
             return loop;
         }
@@ -508,188 +822,157 @@ unsigned short Board::bitboardArrayIndexFromBit( unsigned long long bit ) const
     return 0;
 }
 
-const char Board::pieceFromBitboardArrayIndex( unsigned short arrayIndex )
+const char Board::letterFromPiece( unsigned short color, unsigned short piece )
 {
-    return "-PNBRQKpnbrqk"[ arrayIndex ];
+    return "PNBRQKpnbrqk"[ color * 6 + piece ];
 }
 
-unsigned short Board::bitboardArrayIndexFromPiece( const char piece )
+unsigned short Board::pieceLetterIndex( const char letter )
 {
-    switch ( piece )
+    switch ( letter )
     {
         default:
-        case '-':
-            return EMPTY;
-
         case 'P':
-            return WHITE + PAWN;
+            return 0;
 
         case 'N':
-            return WHITE + KNIGHT;
+            return 1;
 
         case 'B':
-            return WHITE + BISHOP;
+            return 2;
 
         case 'R':
-            return WHITE + ROOK;
+            return 3;
 
         case 'Q':
-            return WHITE + QUEEN;
+            return 4;
 
         case 'K':
-            return WHITE + KING;
+            return 5;
 
         case 'p':
-            return BLACK + PAWN;
+            return 6;
 
         case 'n':
-            return BLACK + KNIGHT;
+            return 7;
 
         case 'b':
-            return BLACK + BISHOP;
+            return 8;
 
         case 'r':
-            return BLACK + ROOK;
+            return 9;
 
         case 'q':
-            return BLACK + QUEEN;
+            return 10;
 
         case 'k':
-            return BLACK + KING;
+            return 11;
     }
 }
 
 Board::State::State( const Board& board ) :
-    bitboards( board.bitboards ),
-    whiteToMove( board.whiteToMove ),
+    pieces( board.pieces ),
+    colors( board.colors ),
+    leaperAttacks( board.leaperAttacks ),
+    sliderAttacks( board.sliderAttacks ),
+    pieceKey( board.pieceKey ),
+    attacksOccupied( board.attacksOccupied ),
     castlingRights( board.castlingRights ),
-    enPassantIndex( board.enPassantIndex ),
+    enPassantSquare( board.enPassantSquare ),
+    whiteToMove( board.whiteToMove ),
+    staleAttacks( board.staleAttacks ),
     halfMoveClock( board.halfMoveClock ),
-    fullMoveNumber( board.fullMoveNumber ),
-    whitePieces( board.whitePieces ),
-    blackPieces( board.blackPieces )
+    fullMoveNumber( board.fullMoveNumber )
 {
 }
 
 void Board::State::apply( Board& board ) const
 {
-    board.bitboards = bitboards;
-    board.whiteToMove = whiteToMove;
+    board.pieces = pieces;
+    board.colors = colors;
+    board.leaperAttacks = leaperAttacks;
+    board.sliderAttacks = sliderAttacks;
+    board.pieceKey = pieceKey;
+    board.attacksOccupied = attacksOccupied;
     board.castlingRights = castlingRights;
-    board.enPassantIndex = enPassantIndex;
+    board.enPassantSquare = enPassantSquare;
+    board.whiteToMove = whiteToMove;
+    board.staleAttacks = staleAttacks;
     board.halfMoveClock = halfMoveClock;
     board.fullMoveNumber = fullMoveNumber;
-    board.whitePieces = whitePieces;
-    board.blackPieces = blackPieces;
 }
 
-void Board::getPawnMoves( std::vector<Move>& moves, const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces )
+void Board::getPawnMoves( std::vector<Move>& moves, unsigned long long pawns, const unsigned long long& attackPieces )
 {
-    const unsigned short promotionRankFrom = whiteToMove ? 6 : 1;
-    const unsigned short homeRankFrom = whiteToMove ? 1 : 6;
+    // Work on all the pawns at once by shifting the whole bitboard, then turn the destination sets back into moves.
+    // Shift offsets are in the direction of travel, so the "from" square of a move is always "to - offset"
+    const unsigned long long empty = emptySquares();
+    const unsigned long long promotionRank = BitBoard::getRankMask( whiteToMove ? 7 : 0 );
+    const unsigned long long doublePushRank = BitBoard::getRankMask( whiteToMove ? 3 : 4 );
+
+    const int forward = whiteToMove ? 8 : -8;
+    const int captureWest = whiteToMove ? 7 : -9;
+    const int captureEast = whiteToMove ? 9 : -7;
+
+    // Single and double pushes - a double push is a single push that can go one step further onto the fourth (fifth) rank
+    unsigned long long singlePushes = shift( pawns, forward ) & empty;
+    unsigned long long doublePushes = shift( singlePushes, forward ) & empty & doublePushRank;
+
+    // Captures, not letting pawns on the edge files wrap around the board
+    unsigned long long westAttacks = shift( pawns & ~BitBoard::getFileMask( 0 ), captureWest );
+    unsigned long long eastAttacks = shift( pawns & ~BitBoard::getFileMask( 7 ), captureEast );
+
+    addPawnMoves( moves, singlePushes & ~promotionRank, forward, Move::QUIET );
+    addPawnMoves( moves, doublePushes, forward * 2, Move::DOUBLE_PAWN_PUSH );
+    addPawnMoves( moves, westAttacks & attackPieces & ~promotionRank, captureWest, Move::CAPTURE );
+    addPawnMoves( moves, eastAttacks & attackPieces & ~promotionRank, captureEast, Move::CAPTURE );
+
+    // Promotions, with and without capture
+    addPawnPromotions( moves, singlePushes & promotionRank, forward, Move::KNIGHT_PROMOTION );
+    addPawnPromotions( moves, westAttacks & attackPieces & promotionRank, captureWest, Move::KNIGHT_PROMOTION_CAPTURE );
+    addPawnPromotions( moves, eastAttacks & attackPieces & promotionRank, captureEast, Move::KNIGHT_PROMOTION_CAPTURE );
+
+    // En passant - can never be on the promotion rank
+    addPawnMoves( moves, westAttacks & enPassantBit(), captureWest, Move::EN_PASSANT_CAPTURE );
+    addPawnMoves( moves, eastAttacks & enPassantBit(), captureEast, Move::EN_PASSANT_CAPTURE );
+}
 
-    unsigned long long pieces;
-    unsigned long index;
+void Board::addPawnMoves( std::vector<Move>& moves, unsigned long long destinations, const int& offset, const unsigned short& flags )
+{
     unsigned long destination;
-    unsigned long long baselinePawns = 0;
 
-    unsigned short rankFrom;
-    unsigned long long possibleMoves;
-
-    pieces = bitboards[ pieceIndex ];
-    while ( _BitScanForward64( &index, pieces ) )
+    while ( _BitScanForward64( &destination, destinations ) )
     {
-        pieces ^= 1ull << index;
-
-        rankFrom = ( index >> 3 ) & 0b00000111;
+        destinations ^= 1ull << destination;
 
-        possibleMoves = whiteToMove ? BitBoard::getWhitePawnNormalMoveMask( index ) : BitBoard::getBlackPawnNormalMoveMask( index );
-
-        possibleMoves &= emptySquares();
-
-        while ( _BitScanForward64( &destination, possibleMoves ) )
-        {
-            possibleMoves ^= 1ull << destination;
-
-            // Check whether any are elegible to make the extended move (e.g. e2e4) or promote
-            if ( rankFrom == homeRankFrom )
-            {
-                baselinePawns |= 1ull << index;
-                moves.push_back( Move( index, destination ) );
-            }
-            else if ( rankFrom == promotionRankFrom )
-            {
-                moves.push_back( Move( index, destination, Move::KNIGHT ) );
-                moves.push_back( Move( index, destination, Move::BISHOP ) );
-                moves.push_back( Move( index, destination, Move::ROOK ) );
-                moves.push_back( Move( index, destination, Move::QUEEN ) );
-            }
-            else
-            {
-                moves.push_back( Move( index, destination ) );
-            }
-        }
+        moves.push_back( Move( destination - offset, destination, flags ) );
     }
+}
 
-    // Of the pawns that could make a single move, which can also make the double move?
-    pieces = baselinePawns;
-    while ( _BitScanForward64( &index, pieces ) )
-    {
-        pieces ^= 1ull << index;
-
-        possibleMoves = whiteToMove ? BitBoard::getWhitePawnExtendedMoveMask( index ) : BitBoard::getBlackPawnExtendedMoveMask( index );
-
-        possibleMoves &= emptySquares();
-
-        while ( _BitScanForward64( &destination, possibleMoves ) )
-        {
-            possibleMoves ^= 1ull << destination;
-
-            // No need to check promotion here as this is only for pawns on their home rank
-            moves.push_back( Move( index, destination ) );
-        }
-    }
+void Board::addPawnPromotions( std::vector<Move>& moves, unsigned long long destinations, const int& offset, const unsigned short& knightFlags )
+{
+    unsigned long destination;
 
-    // Captures, including ep
-    pieces = bitboards[ pieceIndex ];
-    while ( _BitScanForward64( &index, pieces ) )
+    // The other promotion flags follow on from the knight one
+    while ( _BitScanForward64( &destination, destinations ) )
     {
-        pieces ^= 1ull << index;
-
-        rankFrom = ( index >> 3 ) & 0b00000111;
-        possibleMoves = whiteToMove ? BitBoard::getWhitePawnAttackMoveMask( index ) : BitBoard::getBlackPawnAttackMoveMask( index );
-
-        possibleMoves &= ( attackPieces | enPassantIndex );
+        destinations ^= 1ull << destination;
 
-        while ( _BitScanForward64( &destination, possibleMoves ) )
-        {
-            possibleMoves ^= 1ull << destination;
-
-            if ( rankFrom == promotionRankFrom )
-            {
-                moves.push_back( Move( index, destination, Move::KNIGHT ) );
-                moves.push_back( Move( index, destination, Move::BISHOP ) );
-                moves.push_back( Move( index, destination, Move::ROOK ) );
-                moves.push_back( Move( index, destination, Move::QUEEN ) );
-            }
-            else
-            {
-                moves.push_back( Move( index, destination ) );
-            }
-        }
+        moves.push_back( Move( destination - offset, destination, knightFlags ) );
+        moves.push_back( Move( destination - offset, destination, knightFlags + 1 ) );
+        moves.push_back( Move( destination - offset, destination, knightFlags + 2 ) );
+        moves.push_back( Move( destination - offset, destination, knightFlags + 3 ) );
     }
 }
 
-void Board::getKnightMoves( std::vector<Move>& moves, const unsigned short& pieceIndex, const unsigned long long& accessibleSquares )
+void Board::getKnightMoves( std::vector<Move>& moves, unsigned long long knights, const unsigned long long& accessibleSquares )
 {
-    unsigned long long pieces;
     unsigned long index;
     unsigned long destination;
 
-    pieces = bitboards[ pieceIndex ];
-    while ( _BitScanForward64( &index, pieces ) )
+    while ( _BitScanForward64( &index, knights ) )
     {
-        pieces ^= 1ull << index;
+        knights ^= 1ull << index;
 
         unsigned long long possibleMoves = BitBoard::getKnightMoveMask( index );
 
@@ -699,20 +982,18 @@ void Board::getKnightMoves( std::vector<Move>& moves, const unsigned short& piec
         {
             possibleMoves ^= 1ull << destination;
 
-            moves.push_back( Move( index, destination ) );
+            moves.push_back( Move( index, destination, isEmpty( 1ull << destination ) ? Move::QUIET : Move::CAPTURE ) );
         }
     }
 }
 
-void Board::getBishopMoves( std::vector<Move>& moves, const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces )
+void Board::getBishopMoves( std::vector<Move>& moves, unsigned long long bishops, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces )
 {
-    unsigned long long pieces;
     unsigned long index;
 
-    pieces = bitboards[ pieceIndex ];
-    while ( _BitScanForward64( &index, pieces ) )
+    while ( _BitScanForward64( &index, bishops ) )
     {
-        pieces ^= 1ull << index;
+        bishops ^= 1ull << index;
 
         getDirectionalMoves( moves, index, accessibleSquares, attackPieces, blockingPieces, &BitBoard::getNorthEastMoveMask, &scanForward );
         getDirectionalMoves( moves, index, accessibleSquares, attackPieces, blockingPieces, &BitBoard::getNorthWestMoveMask, &scanForward );
@@ -722,15 +1003,13 @@ void Board::getBishopMoves( std::vector<Move>& moves, const unsigned short& piec
     }
 }
 
-void Board::getRookMoves( std::vector<Move>& moves, const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces )
+void Board::getRookMoves( std::vector<Move>& moves, unsigned long long rooks, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces )
 {
-    unsigned long long pieces;
     unsigned long index;
 
-    pieces = bitboards[ pieceIndex ];
-    while ( _BitScanForward64( &index, pieces ) )
+    while ( _BitScanForward64( &index, rooks ) )
     {
-        pieces ^= 1ull << index;
+        rooks ^= 1ull << index;
 
         getDirectionalMoves( moves, index, accessibleSquares, attackPieces, blockingPieces, &BitBoard::getNorthMoveMask, &scanForward );
         getDirectionalMoves( moves, index, accessibleSquares, attackPieces, blockingPieces, &BitBoard::getWestMoveMask, &scanForward );
@@ -740,15 +1019,13 @@ void Board::getRookMoves( std::vector<Move>& moves, const unsigned short& pieceI
     }
 }
 
-void Board::getQueenMoves( std::vector<Move>& moves, const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces )
+void Board::getQueenMoves( std::vector<Move>& moves, unsigned long long queens, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces )
 {
-    unsigned long long pieces;
     unsigned long index;
 
-    pieces = bitboards[ pieceIndex ];
-    while ( _BitScanForward64( &index, pieces ) )
+    while ( _BitScanForward64( &index, queens ) )
     {
-        pieces ^= 1ull << index;
+        queens ^= 1ull << index;
 
         getDirectionalMoves( moves, index, accessibleSquares, attackPieces, blockingPieces, &BitBoard::getNorthMoveMask, &scanForward );
         getDirectionalMoves( moves, index, accessibleSquares, attackPieces, blockingPieces, &BitBoard::getWestMoveMask, &scanForward );
@@ -762,15 +1039,13 @@ void Board::getQueenMoves( std::vector<Move>& moves, const unsigned short& piece
     }
 }
 
-void Board::getKingMoves( std::vector<Move>& moves, const unsigned short& pieceIndex, const unsigned long long& accessibleSquares )
+void Board::getKingMoves( std::vector<Move>& moves, unsigned long long king, const unsigned long long& accessibleSquares, const unsigned long long& opponentAttacks )
 {
-    unsigned long long pieces;
     unsigned long index;
     unsigned long destination;
 
     // There is only one king, so we can use an if, not a when here and be sure we're only going round once
-    pieces = bitboards[ pieceIndex ];
-    if ( _BitScanForward64( &index, pieces ) )
+    if ( _BitScanForward64( &index, king ) )
     {
         unsigned long long possibleMoves = BitBoard::getKingMoveMask( index );
 
@@ -780,7 +1055,7 @@ void Board::getKingMoves( std::vector<Move>& moves, const unsigned short& pieceI
         {
             possibleMoves ^= 1ull << destination;
 
-            moves.push_back( Move( index, destination ) );
+            moves.push_back( Move( index, destination, isEmpty( 1ull << destination ) ? Move::QUIET : Move::CAPTURE ) );
         }
 
         // Check whether castling is a possibility
@@ -788,55 +1063,55 @@ void Board::getKingMoves( std::vector<Move>& moves, const unsigned short& pieceI
         unsigned long long castlingMask;
         if ( whiteToMove )
         {
-            if ( castlingRights[ 0 ] )
+            if ( castlingRights & WHITE_KINGSIDE )
             {
                 castlingMask = BitBoard::getWhiteKingsideCastlingMask();
 
                 if ( ( allEmptySquares & castlingMask ) == castlingMask )
                 {
                     // Test for the king travelling through check
-                    if ( !isAttacked( 0b01110000, whiteToMove ) )
+                    if ( !( opponentAttacks & 0b01110000 ) )
                     {
-                        moves.push_back( Move( index, index + 2 ) );
+                        moves.push_back( Move( index, index + 2, Move::KINGSIDE_CASTLE ) );
                     }
                 }
             }
-            if ( castlingRights[ 1 ] )
+            if ( castlingRights & WHITE_QUEENSIDE )
             {
                 castlingMask = BitBoard::getWhiteQueensideCastlingMask();
 
                 if ( ( allEmptySquares & castlingMask ) == castlingMask )
                 {
-                    if ( !isAttacked( 0b00011100, whiteToMove ) )
+                    if ( !( opponentAttacks & 0b00011100 ) )
                     {
-                        moves.push_back( Move( index, index - 2 ) );
+                        moves.push_back( Move( index, index - 2, Move::QUEENSIDE_CASTLE ) );
                     }
                 }
             }
         }
         else
         {
-            if ( castlingRights[ 2 ] )
+            if ( castlingRights & BLACK_KINGSIDE )
             {
                 castlingMask = BitBoard::getBlackKingsideCastlingMask();
 
                 if ( ( allEmptySquares & castlingMask ) == castlingMask )
                 {
-                    if ( !isAttacked( 0b0111000000000000000000000000000000000000000000000000000000000000, whiteToMove ) )
+                    if ( !( opponentAttacks & 0b0111000000000000000000000000000000000000000000000000000000000000 ) )
                     {
-                        moves.push_back( Move( index, index + 2 ) );
+                        moves.push_back( Move( index, index + 2, Move::KINGSIDE_CASTLE ) );
                     }
                 }
             }
-            if ( castlingRights[ 3 ] )
+            if ( castlingRights & BLACK_QUEENSIDE )
             {
                 castlingMask = BitBoard::getBlackQueensideCastlingMask();
 
                 if ( ( allEmptySquares & castlingMask ) == castlingMask )
                 {
-                    if ( !isAttacked( 0b0001110000000000000000000000000000000000000000000000000000000000, whiteToMove ) )
+                    if ( !( opponentAttacks & 0b0001110000000000000000000000000000000000000000000000000000000000 ) )
                     {
-                        moves.push_back( Move( index, index - 2 ) );
+                        moves.push_back( Move( index, index - 2, Move::QUEENSIDE_CASTLE ) );
                     }
                 }
             }
@@ -844,83 +1119,6 @@ void Board::getKingMoves( std::vector<Move>& moves, const unsigned short& pieceI
     }
 }
 
-bool Board::isAttacked( unsigned long long mask, bool asWhite )
-{
-    const unsigned short bitboardPieceIndex = asWhite ? BLACK : WHITE;
-
-    unsigned long long attackerSquares;
-
-    // For each mask square...
-
-    unsigned long index;
-    while ( _BitScanForward64( &index, mask ) )
-    {
-        mask ^= 1ull << index;
-
-        // Pawn
-        // Get our own pawn attack mask and look from our square of interest - because that tells us where
-        // opponent pawns would need to be to be a threat
-        attackerSquares = asWhite ? BitBoard::getWhitePawnAttackMoveMask( index ) : BitBoard::getBlackPawnAttackMoveMask( index );
-        if ( attackerSquares & bitboards[ bitboardPieceIndex + PAWN ] )
-        {
-            return true;
-        }
-
-        // Knight
-        // Somewhat like the pawn, we can look at the knight moves from where we are and see if attackers are there
-        attackerSquares = BitBoard::getKnightMoveMask( index );
-
-        if ( attackerSquares & bitboards[ bitboardPieceIndex + KNIGHT ] )
-        {
-            return true;
-        }
-
-        // Bishop + Queen
-        if ( isAttacked( index, bitboards[ bitboardPieceIndex + BISHOP ] | bitboards[ bitboardPieceIndex + QUEEN ], &BitBoard::getNorthWestMoveMask, scanForward ) ||
-             isAttacked( index, bitboards[ bitboardPieceIndex + BISHOP ] | bitboards[ bitboardPieceIndex + QUEEN ], &BitBoard::getNorthEastMoveMask, scanForward ) ||
-             isAttacked( index, bitboards[ bitboardPieceIndex + BISHOP ] | bitboards[ bitboardPieceIndex + QUEEN ], &BitBoard::getSouthWestMoveMask, scanReverse ) ||
-             isAttacked( index, bitboards[ bitboardPieceIndex + BISHOP ] | bitboards[ bitboardPieceIndex + QUEEN ], &BitBoard::getSouthEastMoveMask, scanReverse ) )
-        {
-            return true;
-        }
-
-        // Rook + Queen
-        if ( isAttacked( index, bitboards[ bitboardPieceIndex + ROOK ] | bitboards[ bitboardPieceIndex + QUEEN ], &BitBoard::getNorthMoveMask, scanForward ) || 
-             isAttacked( index, bitboards[ bitboardPieceIndex + ROOK ] | bitboards[ bitboardPieceIndex + QUEEN ], &BitBoard::getWestMoveMask, scanForward ) || 
-             isAttacked( index, bitboards[ bitboardPieceIndex + ROOK ] | bitboards[ bitboardPieceIndex + QUEEN ], &BitBoard::getSouthMoveMask, scanReverse ) || 
-             isAttacked( index, bitboards[ bitboardPieceIndex + ROOK ] | bitboards[ bitboardPieceIndex + QUEEN ], &BitBoard::getEastMoveMask, scanReverse ) )
-        {
-            return true;
-        }
-
-        // King
-        attackerSquares = BitBoard::getKingMoveMask( index );
-
-        if ( attackerSquares & bitboards[ bitboardPieceIndex + KING ] )
-        {
-            return true;
-        }
-    }
-
-    return false;
-}
-
-bool Board::isAttacked( const unsigned long& index, const unsigned long long& attackingPieces, DirectionMask directionMask, BitScanner bitScanner )
-{
-    unsigned long long attackMask = directionMask( index ) & ~emptySquares();
-
-    unsigned long closest;
-    if ( bitScanner( &closest, attackMask ) )
-    {
-        if ( attackingPieces & ( 1ull << closest ) )
-        {
-            return true;
-        }
-    }
-
-    return false;
-}
-
 // Pass a scanner in here so that we can look either forward or reverse to make sure we check the closest attacker/blocker and
 // don't waste time checking those further away
 void Board::getDirectionalMoves( std::vector<Move>& moves, const unsigned long& index, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces, DirectionMask directionMask, BitScanner bitScanner )
@@ -952,6 +1150,6 @@ void Board::getDirectionalMoves( std::vector<Move>& moves, const unsigned long&
     {
         possibleMoves ^= 1ull << otherIndex;
 
-        moves.push_back( Move( index, otherIndex ) );
+        moves.push_back( Move( index, otherIndex, attackPieces & ( 1ull << otherIndex ) ? Move::CAPTURE : Move::QUIET ) );
     }
 }
@@ -7,14 +7,20 @@
 #include <vector>
 
 #include "Move.h"
+#include "Zobrist.h"
 
-class Board
+// Kept compact (six piece-type bitboards, two color bitboards and a few bytes of state) and cache line
+// aligned so that a position spans at most two cache lines and is cheap to copy
+class alignas( 64 ) Board
 {
 private:
-    static const unsigned short EMPTY;
+    friend class BatchCounter;
+
+    // Indices into colors
     static const unsigned short WHITE;
     static const unsigned short BLACK;
 
+    // Indices into pieces
     static const unsigned short PAWN;
     static const unsigned short KNIGHT;
     static const unsigned short BISHOP;
@@ -22,147 +28,249 @@ private:
     static const unsigned short QUEEN;
     static const unsigned short KING;
 
-    // Lucky 13 - empty, 6 white pieces, 6 black pieces
-    std::array<unsigned long long, 13> bitboards;
+    // Castling rights bits
+    static const unsigned char WHITE_KINGSIDE;
+    static const unsigned char WHITE_QUEENSIDE;
+    static const unsigned char BLACK_KINGSIDE;
+    static const unsigned char BLACK_QUEENSIDE;
 
-    unsigned long long whitePieces;
-    unsigned long long blackPieces;
+    // En passant square value when there isn't one - a1 can never be an ep square
+    static const unsigned char NO_EN_PASSANT;
 
-    bool whiteToMove;
+    /// <summary>
+    /// Castling rights that survive a move to or from each square
+    /// </summary>
+    static const unsigned char castlingRightsMask[ 64 ];
+
+    /// <summary>
+    /// The staleAttacks bit for White's attack map that each piece type belongs to - shifted up by the color for Black
+    /// </summary>
+    static const unsigned char staleAttacksMask[ 6 ];
 
-    std::array<bool, 4> castlingRights;
+    // One bitboard per piece type, regardless of color, and one per color
+    std::array<unsigned long long, 6> pieces;
+    std::array<unsigned long long, 2> colors;
 
-    unsigned long long enPassantIndex;
+    // Squares attacked by each color's pawns, knights and king, and by its sliders
+    std::array<unsigned long long, 2> leaperAttacks;
+    std::array<unsigned long long, 2> sliderAttacks;
+
+    // Zobrist key for the pieces alone, kept up to date by applyMove. The keys of the mirrored positions that
+    // -symmetric lookups use are worked out when asked for instead, so that every other search copies less
+    unsigned long long pieceKey;
+
+    // The occupied squares that each color's slider attacks were worked out for. Moves don't touch the attacks -
+    // they only mark the maps of the pieces they move, take or promote to in staleAttacks, and updateAttacks redoes
+    // just those (and any slider rays the occupancy changes cross) for the side asked about, so leaf moves that are
+    // made but never searched cost nothing, and neither does the mover's side while testing a move's legality
+    std::array<unsigned long long, 2> attacksOccupied;
+
+    unsigned char castlingRights;
+
+    unsigned char enPassantSquare;
+
+    bool whiteToMove;
+
+    unsigned char staleAttacks;
 
     unsigned short halfMoveClock;
     unsigned short fullMoveNumber;
 
-    Board( std::array<unsigned long long, 13> bitboards,
+    Board( std::array<unsigned long long, 6> pieces,
+           std::array<unsigned long long, 2> colors,
            bool whiteToMove,
-           std::array<bool, 4> castlingRights,
-           unsigned long long enPassantIndex,
+           unsigned char castlingRights,
+           unsigned char enPassantSquare,
            unsigned short halfMoveClock,
            unsigned short fullMoveNumber ) :
-        bitboards( bitboards ),
-        whiteToMove( whiteToMove ),
+        pieces( pieces ),
+        colors( colors ),
         castlingRights( castlingRights ),
-        enPassantIndex( enPassantIndex ),
+        enPassantSquare( enPassantSquare ),
+        whiteToMove( whiteToMove ),
         halfMoveClock( halfMoveClock ),
         fullMoveNumber( fullMoveNumber )
     {
-        whitePieces = blackPieces = 0;
-
-        for ( size_t loop = WHITE; loop < bitboards.size(); loop++ )
+        for ( unsigned short color = WHITE; color <= BLACK; color++ )
         {
-            if ( loop < BLACK )
-            {
-                whitePieces |= bitboards[ loop ];
-            }
-            else
-            {
-                blackPieces |= bitboards[ loop ];
-            }
+            leaperAttacks[ color ] = getLeaperAttacks( color );
+            updateSliderAttacks( color );
         }
+
+        attacksOccupied = { occupiedSquares(), occupiedSquares() };
+        staleAttacks = 0;
+
+        initializePieceKey();
     }
 
     // Instance methods
     inline bool isEmpty( unsigned long long bit ) const;
 
+    inline unsigned long long occupiedSquares() const
+    {
+        return colors[ WHITE ] | colors[ BLACK ];
+    }
+
     inline unsigned long long emptySquares() const
     {
-        return bitboards[ EMPTY ];
+        return ~occupiedSquares();
+    }
+
+    /// <summary>
+    /// The pieces of one type and color
+    /// </summary>
+    /// <param name="color">WHITE or BLACK</param>
+    /// <param name="piece">the piece type</param>
+    /// <returns></returns>
+    inline unsigned long long getPieces( unsigned short color, unsigned short piece ) const
+    {
+        return pieces[ piece ] & colors[ color ];
     }
 
     /// <summary>
-    /// Find which bitboard array has bit set and return its index
+    /// The ep square as a bit, or 0 if there isn't one
+    /// </summary>
+    inline unsigned long long enPassantBit() const
+    {
+        return enPassantSquare == NO_EN_PASSANT ? 0 : 1ull << enPassantSquare;
+    }
+
+    /// <summary>
+    /// Find which piece type has bit set and return its index
     /// </summary>
     /// <param name="bit"></param>
     /// <returns></returns>
-    inline unsigned short bitboardArrayIndexFromBit( unsigned long long bit ) const;
+    inline unsigned short pieceFromBit( unsigned long long bit ) const;
 
     // Static methods
 
     /// <summary>
-    /// Piece letteer from bitboard array index
+    /// Piece letter from color and piece type
     /// </summary>
-    /// <param name="arrayIndex"></param>
+    /// <param name="color"></param>
+    /// <param name="piece"></param>
     /// <returns></returns>
-    inline static const char pieceFromBitboardArrayIndex( unsigned short arrayIndex );
+    inline static const char letterFromPiece( unsigned short color, unsigned short piece );
 
     /// <summary>
-    /// Bitboard array index from piece letter
+    /// Index into "PNBRQKpnbrqk" from piece letter - color is index / 6 and piece type index % 6
     /// </summary>
-    /// <param name="piece"></param>
+    /// <param name="letter"></param>
     /// <returns></returns>
-    inline static unsigned short bitboardArrayIndexFromPiece( const char piece );
+    inline static unsigned short pieceLetterIndex( const char letter );
 
     /// <summary>
-    /// Convert Move representation of piece to bitboard array index
+    /// Convert Move promotion flags to a piece type
     /// </summary>
-    /// <param name="promotion"></param>
+    /// <param name="flags">the move flags</param>
     /// <returns></returns>
-    inline static unsigned short bitboardArrayIndexFromPromotion( unsigned long promotion )
+    inline static unsigned short pieceFromPromotion( unsigned short flags )
     {
-        return promotion == Move::KNIGHT ? 
-            KNIGHT : promotion == Move::BISHOP ? 
-            BISHOP : promotion == Move::ROOK ? 
-            ROOK : QUEEN;
+        // The promotion pieces are in the same order in Move as they are here
+        return KNIGHT + ( flags & Move::PROMOTION_PIECE_MASK );
     }
 
     /// <summary>
     /// Move a piece where there is no captured involved - e.g. moving the rook during castling
     /// </summary>
-    /// <param name="piece">which piece (bitboard index)</param>
+    /// <param name="color">which color</param>
+    /// <param name="piece">which piece type</param>
     /// <param name="from">from bit</param>
     /// <param name="to">to bit</param>
-    inline void movePiece( unsigned short piece, unsigned long long from, unsigned long long to )
+    inline void movePiece( unsigned short color, unsigned short piece, unsigned long long from, unsigned long long to )
     {
-        bitboards[ piece ] ^= (from | to);
-        bitboards[ EMPTY ] ^= (from | to);
+        pieces[ piece ] ^= (from | to);
+        colors[ color ] ^= (from | to);
     }
 
     /// <summary>
     /// Remove a piece from the board
     /// </summary>
-    /// <param name="piece">the piece</param>
+    /// <param name="color">the color</param>
+    /// <param name="piece">the piece type</param>
     /// <param name="location">location bit</param>
-    inline void liftPiece( unsigned short piece, unsigned long long location )
+    inline void liftPiece( unsigned short color, unsigned short piece, unsigned long long location )
     {
-        bitboards[ piece ] ^= location;
-        bitboards[ EMPTY ] ^= location;
+        pieces[ piece ] ^= location;
+        colors[ color ] ^= location;
     }
 
     /// <summary>
-    /// Put a piece onto the board, and deal with whether it is a capture
+    /// Put a piece onto an empty square - any captured piece must already have been lifted
     /// </summary>
-    /// <param name="piece"></param>
-    /// <param name="location"></param>
-    /// <param name="replacingPiece"></param>
-    inline void placePiece( unsigned short piece, unsigned long long location, unsigned short replacingPiece )
-    {
-        // Remove from all places and then put back into one place - brute force, but allows it to deal with captures
-        //for ( std::array<unsigned long long, 13>::iterator it = bitboards.begin(); it != bitboards.end(); it++ )
-        //{
-        //    (*it) &= ~location;
-        //}
-
-        bitboards[ piece ] |= location;
-        bitboards[ replacingPiece ] &= ~location;
+    /// <param name="color">the color</param>
+    /// <param name="piece">the piece type</param>
+    /// <param name="location">location bit</param>
+    inline void placePiece( unsigned short color, unsigned short piece, unsigned long long location )
+    {
+        pieces[ piece ] |= location;
+        colors[ color ] |= location;
     }
 
-    void getPawnMoves( std::vector<Move>& moves, const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces );
-    void getKnightMoves( std::vector<Move>& moves, const unsigned short& pieceIndex, const unsigned long long& accessibleSquares );
-    void getBishopMoves( std::vector<Move>& moves, const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces );
-    void getRookMoves( std::vector<Move>& moves, const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces );
-    void getQueenMoves( std::vector<Move>& moves, const unsigned short& pieceIndex, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces );
-    void getKingMoves( std::vector<Move>& moves, const unsigned short& pieceIndex, const unsigned long long& accessibleSquares );
+    void getPawnMoves( std::vector<Move>& moves, unsigned long long pawns, const unsigned long long& attackPieces );
+    static void addPawnMoves( std::vector<Move>& moves, unsigned long long destinations, const int& offset, const unsigned short& flags );
+    static void addPawnPromotions( std::vector<Move>& moves, unsigned long long destinations, const int& offset, const unsigned short& knightFlags );
+    void getKnightMoves( std::vector<Move>& moves, unsigned long long knights, const unsigned long long& accessibleSquares );
+    void getBishopMoves( std::vector<Move>& moves, unsigned long long bishops, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces );
+    void getRookMoves( std::vector<Move>& moves, unsigned long long rooks, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces );
+    void getQueenMoves( std::vector<Move>& moves, unsigned long long queens, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces );
+    void getKingMoves( std::vector<Move>& moves, unsigned long long king, const unsigned long long& accessibleSquares, const unsigned long long& opponentAttacks );
+
+    /// <summary>
+    /// Every square attacked by one side in the current position - call updateAttacks for that side first
+    /// </summary>
+    /// <param name="color">the attacking side</param>
+    /// <returns>a mask of all attacked squares</returns>
+    inline unsigned long long getAttacks( unsigned short color ) const
+    {
+        return leaperAttacks[ color ] | sliderAttacks[ color ];
+    }
+
+    /// <summary>
+    /// Squares attacked by one side's pawns, knights and king, worked out from scratch
+    /// </summary>
+    /// <param name="color">the attacking side</param>
+    /// <returns>a mask of all attacked squares</returns>
+    unsigned long long getLeaperAttacks( unsigned short color ) const;
+
+    /// <summary>
+    /// Every square attacked by one side, with sliders blocked by the given occupancy
+    /// </summary>
+    /// <param name="color">the attacking side</param>
+    /// <param name="occupied">the squares that block sliders</param>
+    /// <returns>a mask of all attacked squares</returns>
+    unsigned long long getAttacks( unsigned short color, unsigned long long occupied ) const;
+
+    void updateSliderAttacks( unsigned short color );
 
     /// <summary>
-    /// Returns true if any square indicated in the mask is attacked by the current opponent
+    /// Bring one side's attacks up to date with any moves made since they were last worked out, recomputing only
+    /// those that could have changed
     /// </summary>
-    /// <param name="mask">bit or bits to test</param>
-    /// <returns>true if the opponent is currently attacking any of these squares</returns>
-    bool isAttacked( unsigned long long mask, bool asWhite );
+    /// <param name="color">the attacking side</param>
+    void updateAttacks( unsigned short color );
+
+    /// <summary>
+    /// The staleAttacks bit for the attack map a piece belongs to - its side's leapers or its side's sliders
+    /// </summary>
+    /// <param name="color">the piece's color</param>
+    /// <param name="piece">the piece type</param>
+    /// <returns>the bit to set when the piece moves, is taken or is promoted to</returns>
+    inline static unsigned char staleAttacksBit( unsigned short color, unsigned short piece )
+    {
+        return static_cast<unsigned char>( staleAttacksMask[ piece ] << color );
+    }
+
+    /// <summary>
+    /// Shift a bitboard towards higher squares for a positive offset and lower squares for a negative one
+    /// </summary>
+    /// <param name="mask">the bitboard</param>
+    /// <param name="offset">the number of squares to shift by</param>
+    /// <returns></returns>
+    inline static unsigned long long shift( unsigned long long mask, int offset )
+    {
+        return offset > 0 ? mask << offset : mask >> -offset;
+    }
 
     typedef unsigned long long ( *DirectionMask )( const unsigned long );
     typedef unsigned char ( *BitScanner )( unsigned long*, unsigned long long );
@@ -178,30 +286,100 @@ private:
     }
 
     void getDirectionalMoves( std::vector<Move>& moves, const unsigned long& index, const unsigned long long& accessibleSquares, const unsigned long long& attackPieces, const unsigned long long& blockingPieces, DirectionMask directionMask, BitScanner bitScanner );
-    bool isAttacked( const unsigned long& index, const unsigned long long& attackingPieces, DirectionMask directionMask, BitScanner bitScanner );
 
-    void applyMove( const Move& move );
+    /// <summary>
+    /// The castling rights that can still be used - the king and the rook both have to be on their starting squares
+    /// </summary>
+    unsigned char getEffectiveCastlingRights() const;
+
+    /// <summary>
+    /// Returns true if there is an ep square and a pawn of the side to move is there to take on it
+    /// </summary>
+    bool isEnPassantCapturable() const;
+
+    void initializePieceKey();
+
+    /// <summary>
+    /// Add or remove a piece from the piece key
+    /// </summary>
+    /// <param name="color">the color</param>
+    /// <param name="piece">the piece type</param>
+    /// <param name="square">the square index</param>
+    inline void togglePieceKey( unsigned short color, unsigned short piece, unsigned long square )
+    {
+        pieceKey ^= Zobrist::getPieceKey( color, piece, square );
+    }
+
+    /// <summary>
+    /// The piece keys of the color-flipped mirror (ranks reversed and colors swapped), the left-right mirror (files
+    /// reversed) and that mirror color-flipped, in that order, worked out from scratch in one pass over the pieces
+    /// </summary>
+    std::array<unsigned long long, 3> getMirroredPieceKeys() const;
+
+    unsigned long long getFlippedZobristKey( const std::array<unsigned long long, 3>& mirroredPieceKeys ) const;
+    void getMirroredZobristKeys( const std::array<unsigned long long, 3>& mirroredPieceKeys, unsigned long long& mirroredKey, unsigned long long& flippedMirroredKey ) const;
 
 public:
     static Board* createBoard( const std::string& fen );
 
     std::string toString() const;
 
+    /// <summary>
+    /// The Zobrist key for this position, worked out from scratch. The key is canonical - castling rights and an
+    /// ep square that can't be used are left out, so positions that only differ in those have the same key
+    /// </summary>
+    unsigned long long getZobristKey() const;
+
+    /// <summary>
+    /// As getZobristKey, but an ep square is only kept if the ep capture is legal, as for repetitions. Moves are
+    /// only generated when there is a pawn in place to make the capture
+    /// </summary>
+    unsigned long long getPositionKey();
+
+    /// <summary>
+    /// The canonical Zobrist key of this position's color-flipped mirror, worked out from scratch
+    /// </summary>
+    unsigned long long getFlippedZobristKey() const;
+
+    /// <summary>
+    /// The keys of the position mirrored left to right (a-file to h-file), and of that mirror color-flipped.
+    /// Worked out from scratch, and only the same perft counts as the position when no castling rights remain
+    /// </summary>
+    /// <param name="mirroredKey">receives the key of the left-right mirror</param>
+    /// <param name="flippedMirroredKey">receives the key of the left-right mirror, color-flipped</param>
+    void getMirroredZobristKeys( unsigned long long& mirroredKey, unsigned long long& flippedMirroredKey ) const;
+
+    /// <summary>
+    /// The same key for a position and its color-flipped mirror - the smaller of the two - and, once no castling
+    /// rights remain, its left-right mirrors as well. Whichever it is, it is the key of a position with the same
+    /// perft counts, so it can share a table with plain keys
+    /// </summary>
+    unsigned long long getSymmetricZobristKey() const;
+
+    /// <summary>
+    /// The pieces giving check to the side to move, worked out from scratch
+    /// </summary>
+    /// <returns>a mask of the checking pieces, empty if not in check</returns>
+    unsigned long long getCheckers() const;
+
     void getMoves( std::vector<Move>& moves );
 
     class State
     {
     private:
-        std::array<unsigned long long, 13> bitboards;
+        std::array<unsigned long long, 6> pieces;
+        std::array<unsigned long long, 2> colors;
+        std::array<unsigned long long, 2> leaperAttacks;
+        std::array<unsigned long long, 2> sliderAttacks;
+        unsigned long long pieceKey;
+        std::array<unsigned long long, 2> attacksOccupied;
+        unsigned char castlingRights;
+        unsigned char enPassantSquare;
         bool whiteToMove;
-        std::array<bool, 4> castlingRights;
-        unsigned long long enPassantIndex;
+        unsigned char staleAttacks;
         unsigned short halfMoveClock;
         unsigned short fullMoveNumber;
 
-        unsigned long long whitePieces;
-        unsigned long long blackPieces;
-
     public:
         State( const Board& board );
 
@@ -210,5 +388,13 @@ public:
 
     Board::State makeMove( const Move& move );
     void unmakeMove( const Board::State& state );
+
+    /// <summary>
+    /// Play a move without saving anything to undo it with - either restore a State taken beforehand or, for
+    /// copy-make, apply it to a copy of the board and throw the copy away afterwards
+    /// </summary>
+    /// <param name="move">a move generated for this position</param>
+    void applyMove( const Move& move );
 };
 
+static_assert( sizeof( Board ) <= 128, "A Board must fit in two cache lines" );
@@ -0,0 +1,106 @@
+#include "Checkpoint.h"
+
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+Checkpoint::Checkpoint() :
+    resumed( 0 ),
+    recorded( 0 )
+{
+}
+
+bool Checkpoint::open( const std::string& filename, bool resume )
+{
+    completed.clear();
+
+    if ( resume )
+    {
+        std::ifstream previous( filename );
+
+        // The end of the last whole line
+        std::streamoff whole = 0;
+
+        std::string line;
+        while ( std::getline( previous, line ) )
+        {
+            // Without a newline the line was still being written
+            if ( previous.eof() )
+            {
+                break;
+            }
+
+            whole = previous.tellg();
+
+            const size_t comma = line.find( ',' );
+            if ( comma == 0 || comma == std::string::npos || line.find_first_not_of( "0123456789" ) != comma )
+            {
+                continue;
+            }
+
+            NodeCount nodes;
+            if ( NodeCount::parse( line.substr( 0, comma ), nodes ) )
+            {
+                completed[ line.substr( comma + 1 ) ] = nodes;
+            }
+        }
+
+        previous.close();
+
+        // Cut off a line that was still being written, so that the next line isn't appended to it and read back
+        // as one line with the wrong count
+        std::error_code error;
+        if ( std::filesystem::exists( filename, error ) && std::filesystem::file_size( filename, error ) > static_cast<unsigned long long>( whole ) )
+        {
+            std::filesystem::resize_file( filename, whole, error );
+
+            if ( error )
+            {
+                std::cout << "Checkpoint file was not opened: " << filename << std::endl;
+                return false;
+            }
+        }
+
+        std::cout << "Checkpoint: resuming with " << completed.size() << " finished subtrees" << std::endl;
+    }
+
+    file.open( filename, resume ? std::ios::app : std::ios::trunc );
+
+    if ( !file.is_open() )
+    {
+        std::cout << "Checkpoint file was not opened: " << filename << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void Checkpoint::setRun( int depth, const std::string& fen )
+{
+    std::stringstream prefix;
+    prefix << depth << "," << fen << ",";
+
+    run = prefix.str();
+}
+
+bool Checkpoint::find( const std::string& moves, NodeCount& nodes )
+{
+    std::unordered_map<std::string, NodeCount>::const_iterator it = completed.find( run + moves );
+
+    if ( it == completed.cend() )
+    {
+        return false;
+    }
+
+    nodes = it->second;
+    resumed++;
+
+    return true;
+}
+
+void Checkpoint::record( const std::string& moves, const NodeCount& nodes )
+{
+    // Flushed straight away, as the process could be killed at any time
+    file << nodes << "," << run << moves << std::endl;
+    recorded++;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+#include "NodeCount.h"
+
+/// <summary>
+/// Subtree counts recorded as each subtree is finished, so that a search that is stopped part way through can be
+/// resumed without repeating the finished work.
+/// The file is text, one subtree per line - "nodes,depth,fen,moves" where fen is the root position, depth the
+/// search depth from the root and moves the path from the root to the subtree. A line is written and flushed as
+/// soon as its subtree is finished, and a last line cut short by the process being killed is ignored and cut off on
+/// resume
+/// </summary>
+class Checkpoint
+{
+private:
+    std::ofstream file;
+    std::unordered_map<std::string, NodeCount> completed;
+
+    // "depth,fen," for the search in progress
+    std::string run;
+
+    unsigned long long resumed;
+    unsigned long long recorded;
+
+public:
+    Checkpoint();
+
+    /// <summary>
+    /// Open the checkpoint file
+    /// </summary>
+    /// <param name="filename">the checkpoint file</param>
+    /// <param name="resume">true to read what is already in the file and add to it, false to start it afresh</param>
+    /// <returns><code>false</code> if the file can't be written</returns>
+    bool open( const std::string& filename, bool resume );
+
+    bool isOpen() const
+    {
+        return file.is_open();
+    }
+
+    /// <summary>
+    /// Start a search - the subtrees that follow are from this root and depth
+    /// </summary>
+    /// <param name="depth">the search depth</param>
+    /// <param name="fen">the root position</param>
+    void setRun( int depth, const std::string& fen );
+
+    /// <summary>
+    /// Look up a finished subtree
+    /// </summary>
+    /// <param name="moves">the moves from the root, separated by spaces</param>
+    /// <param name="nodes">receives the leaf node count if found</param>
+    /// <returns>true if found</returns>
+    bool find( const std::string& moves, NodeCount& nodes );
+
+    /// <summary>
+    /// Record a finished subtree
+    /// </summary>
+    /// <param name="moves">the moves from the root, separated by spaces</param>
+    /// <param name="nodes">the leaf node count</param>
+    void record( const std::string& moves, const NodeCount& nodes );
+
+    unsigned long long getResumed() const
+    {
+        return resumed;
+    }
+
+    unsigned long long getRecorded() const
+    {
+        return recorded;
+    }
+};
@@ -0,0 +1,854 @@
+#include "Distributed.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+
+// Windows allows only 64 sockets in a select set unless told otherwise
+#define FD_SETSIZE 1024
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+
+#include "NodeCount.h"
+#include "Test.h"
+
+struct Distributed::Connection
+{
+    SOCKET socket;
+    std::string received;
+
+    // The unit this worker is searching, or NO_UNIT when idle
+    size_t unit;
+};
+
+const int Distributed::MAX_ATTEMPTS = 3;
+const size_t Distributed::NO_UNIT = SIZE_MAX;
+
+const std::string Distributed::UNITS_EXTENSION = ".units";
+const std::string Distributed::RESULT_EXTENSION = ".result";
+
+void Distributed::expand( int plies, Board* board, size_t rootMove, std::vector<Unit>& units, std::unordered_map<unsigned long long, size_t>& found )
+{
+    if ( plies == 0 )
+    {
+        std::unordered_map<unsigned long long, size_t>::const_iterator it = found.find( board->getZobristKey() );
+
+        if ( it != found.cend() )
+        {
+            units[ it->second ].paths++;
+        }
+        else
+        {
+            found[ board->getZobristKey() ] = units.size();
+            units.push_back( Unit { rootMove, board->getZobristKey(), board->toString(), 1, 0, false } );
+        }
+
+        return;
+    }
+
+    std::vector<Move> moves;
+    moves.reserve( 256 );
+
+    board->getMoves( moves );
+
+    for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+    {
+        Board::State undo = board->makeMove( *it );
+        expand( plies - 1, board, rootMove, units, found );
+        board->unmakeMove( undo );
+    }
+}
+
+void Distributed::splitRoot( Board* root, const std::vector<Move>& rootMoves, int plies, std::vector<Unit>& units )
+{
+    for ( size_t rootMove = 0; rootMove < rootMoves.size(); rootMove++ )
+    {
+        std::unordered_map<unsigned long long, size_t> found;
+
+        Board::State undo = root->makeMove( rootMoves[ rootMove ] );
+        expand( plies - 1, root, rootMove, units, found );
+        root->unmakeMove( undo );
+    }
+}
+
+bool Distributed::readHeader( std::istream& file, const std::string& filename, Header& header )
+{
+    std::string line;
+    std::getline( file, line );
+
+    std::istringstream fields( line );
+
+    std::string word;
+    char comma[ 6 ];
+    if ( !std::getline( fields, word, ',' ) || word != "root" ||
+         !( fields >> header.depth >> comma[ 0 ] >> header.plies >> comma[ 1 ] >> header.shard >> comma[ 2 ] >> header.shards >> comma[ 3 ] >>
+            header.units >> comma[ 4 ] >> std::hex >> header.split >> std::dec >> comma[ 5 ] ) ||
+         std::count( comma, comma + 6, ',' ) != 6 || header.shard >= header.shards ||
+         !std::getline( fields, header.fen ) || header.fen.empty() )
+    {
+        std::cout << "Not a units or result file: " << filename << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void Distributed::writeHeader( std::ostream& file, const Header& header )
+{
+    file << "root," << header.depth << "," << header.plies << "," << header.shard << "," << header.shards << "," << header.units << ","
+         << std::hex << header.split << std::dec << "," << header.fen << "\n";
+}
+
+bool Distributed::sendLine( Connection& connection, const std::string& line )
+{
+    const std::string message = line + "\n";
+
+    for ( size_t sent = 0; sent < message.size(); )
+    {
+        const int result = send( connection.socket, message.data() + sent, static_cast<int>( message.size() - sent ), 0 );
+        if ( result == SOCKET_ERROR )
+        {
+            return false;
+        }
+
+        sent += result;
+    }
+
+    return true;
+}
+
+bool Distributed::receiveLines( Connection& connection, std::vector<std::string>& lines )
+{
+    char buffer[ 4096 ];
+
+    const int result = recv( connection.socket, buffer, sizeof( buffer ), 0 );
+    if ( result == 0 || result == SOCKET_ERROR )
+    {
+        return false;
+    }
+
+    connection.received.append( buffer, result );
+
+    for ( size_t newline = connection.received.find( '\n' ); newline != std::string::npos; newline = connection.received.find( '\n' ) )
+    {
+        lines.push_back( connection.received.substr( 0, newline ) );
+        connection.received.erase( 0, newline + 1 );
+    }
+
+    return true;
+}
+
+bool Distributed::startWorker( unsigned short port, size_t hashMegabytes, const std::string& sharedName, std::vector<void*>& processes )
+{
+    char executable[ MAX_PATH ];
+    if ( GetModuleFileNameA( nullptr, executable, MAX_PATH ) == 0 )
+    {
+        std::cout << "Worker was not started: the executable's path is not known" << std::endl;
+        return false;
+    }
+
+    std::stringstream commandLine;
+    commandLine << "\"" << executable << "\" worker 127.0.0.1 " << port;
+    if ( hashMegabytes > 0 )
+    {
+        commandLine << " -hash " << hashMegabytes;
+    }
+    if ( !sharedName.empty() )
+    {
+        commandLine << " -shared " << sharedName;
+    }
+
+    // CreateProcess may write to the command line, so it needs its own copy
+    std::string command = commandLine.str();
+
+    STARTUPINFOA startupInfo = {};
+    startupInfo.cb = sizeof( startupInfo );
+
+    PROCESS_INFORMATION processInfo = {};
+
+    if ( !CreateProcessA( executable, &command[ 0 ], nullptr, nullptr, FALSE, CREATE_NO_WINDOW, nullptr, nullptr, &startupInfo, &processInfo ) )
+    {
+        std::cout << "Worker was not started: error " << GetLastError() << std::endl;
+        return false;
+    }
+
+    CloseHandle( processInfo.hThread );
+    processes.push_back( processInfo.hProcess );
+
+    return true;
+}
+
+bool Distributed::coordinate( int depth, const std::string& fen, int splitPlies, const std::string& listenAddress, unsigned short port, unsigned int localWorkers, size_t hashMegabytes, const std::string& sharedName, bool divide )
+{
+    if ( depth < 1 )
+    {
+        std::cout << "Invalid depth: " << depth << std::endl;
+        return false;
+    }
+
+    std::cout << fen << std::endl;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Split the tree
+    std::unique_ptr<Board> root( Board::createBoard( fen ) );
+
+    std::vector<Move> rootMoves;
+    root->getMoves( rootMoves );
+
+    const int plies = std::max( 1, std::min( splitPlies, depth ) );
+
+    std::vector<Unit> units;
+    splitRoot( root.get(), rootMoves, plies, units );
+
+    std::cout << "  Split at ply " << plies << " into " << units.size() << " units" << std::endl;
+
+    // Listen for workers
+    WSADATA wsaData;
+    if ( WSAStartup( MAKEWORD( 2, 2 ), &wsaData ) != 0 )
+    {
+        std::cout << "Winsock was not started" << std::endl;
+        return false;
+    }
+
+    // Anyone who can reach the port can take units and send results, so only local workers are let in unless
+    // asked otherwise
+    const std::string bindAddress = !listenAddress.empty() ? listenAddress : localWorkers > 0 ? "127.0.0.1" : "0.0.0.0";
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons( port );
+
+    if ( inet_pton( AF_INET, bindAddress.c_str(), &address.sin_addr ) != 1 )
+    {
+        std::cout << "Invalid address to listen on: " << bindAddress << std::endl;
+        WSACleanup();
+        return false;
+    }
+
+    SOCKET listener = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+
+    if ( listener == INVALID_SOCKET || bind( listener, reinterpret_cast<sockaddr*>( &address ), sizeof( address ) ) == SOCKET_ERROR || listen( listener, SOMAXCONN ) == SOCKET_ERROR )
+    {
+        std::cout << "Could not listen for workers on " << bindAddress << ":" << port << std::endl;
+
+        if ( listener != INVALID_SOCKET )
+        {
+            closesocket( listener );
+        }
+
+        WSACleanup();
+        return false;
+    }
+
+    std::cout << "  Listening for workers on " << bindAddress << ":" << port << std::endl;
+
+    std::vector<void*> processes;
+    for ( unsigned int worker = 0; worker < localWorkers; worker++ )
+    {
+        startWorker( port, hashMegabytes, sharedName, processes );
+    }
+
+    // Hand out the units and gather the results
+    std::deque<size_t> pending;
+    for ( size_t unit = 0; unit < units.size(); unit++ )
+    {
+        pending.push_back( unit );
+    }
+
+    std::vector<NodeCount> rootNodes( rootMoves.size() );
+
+    std::vector<Connection> connections;
+    size_t finished = 0;
+    unsigned int replacements = 0;
+    unsigned long long connected = 0;
+    bool failed = false;
+
+    std::chrono::steady_clock::time_point lastProgress = std::chrono::steady_clock::now();
+
+    while ( finished < units.size() && !failed )
+    {
+        fd_set readable;
+        FD_ZERO( &readable );
+        FD_SET( listener, &readable );
+
+        for ( std::vector<Connection>::const_iterator it = connections.cbegin(); it != connections.cend(); it++ )
+        {
+            FD_SET( it->socket, &readable );
+        }
+
+        timeval timeout = { 1, 0 };
+        if ( select( 0, &readable, nullptr, nullptr, &timeout ) == SOCKET_ERROR )
+        {
+            std::cout << "Waiting for workers failed" << std::endl;
+            failed = true;
+            break;
+        }
+
+        if ( FD_ISSET( listener, &readable ) )
+        {
+            SOCKET accepted = accept( listener, nullptr, nullptr );
+
+            if ( accepted != INVALID_SOCKET && connections.size() + 1 < FD_SETSIZE )
+            {
+                connections.push_back( Connection { accepted, "", NO_UNIT } );
+                connected++;
+            }
+            else if ( accepted != INVALID_SOCKET )
+            {
+                closesocket( accepted );
+            }
+        }
+
+        // Read results, and drop workers that have gone
+        for ( std::vector<Connection>::iterator it = connections.begin(); it != connections.end(); )
+        {
+            std::vector<std::string> lines;
+
+            bool alive = !FD_ISSET( it->socket, &readable ) || receiveLines( *it, lines );
+
+            for ( std::vector<std::string>::const_iterator line = lines.cbegin(); line != lines.cend(); line++ )
+            {
+                std::istringstream message( *line );
+
+                std::string word;
+                size_t id;
+                unsigned long long nodes;
+
+                // Only the unit the worker was given counts - anything else is stale, or not from one of ours
+                if ( message >> word >> id >> nodes && word == "result" && it->unit != NO_UNIT && id == it->unit && id < units.size() && !units[ id ].finished )
+                {
+                    Unit& unit = units[ id ];
+
+                    unit.finished = true;
+                    rootNodes[ unit.rootMove ] += NodeCount::multiply( nodes, unit.paths );
+
+                    finished++;
+                    it->unit = NO_UNIT;
+                }
+            }
+
+            // Hand idle workers more work
+            if ( alive && it->unit == NO_UNIT && !pending.empty() )
+            {
+                it->unit = pending.front();
+                pending.pop_front();
+
+                Unit& unit = units[ it->unit ];
+                unit.attempts++;
+
+                std::stringstream message;
+                message << "unit " << it->unit << " " << depth - plies << " " << unit.fen;
+
+                alive = sendLine( *it, message.str() );
+            }
+
+            if ( alive )
+            {
+                it++;
+                continue;
+            }
+
+            if ( it->unit != NO_UNIT )
+            {
+                if ( units[ it->unit ].attempts >= MAX_ATTEMPTS )
+                {
+                    std::cout << "Unit " << it->unit << " failed " << MAX_ATTEMPTS << " times: " << units[ it->unit ].fen << std::endl;
+                    failed = true;
+                }
+
+                pending.push_front( it->unit );
+            }
+
+            closesocket( it->socket );
+            it = connections.erase( it );
+
+            // Replace it, as it may well have been one of ours
+            if ( localWorkers > 0 && replacements < MAX_ATTEMPTS * localWorkers && finished < units.size() )
+            {
+                replacements++;
+                startWorker( port, hashMegabytes, sharedName, processes );
+            }
+        }
+
+        // With no workers connected and none of ours still running - they may have gone before ever connecting -
+        // start more while there are replacements left, then give up as nothing would finish the remaining units
+        if ( localWorkers > 0 && connections.empty() && !pending.empty() )
+        {
+            bool running = false;
+
+            for ( std::vector<void*>::const_iterator it = processes.cbegin(); it != processes.cend() && !running; it++ )
+            {
+                running = WaitForSingleObject( *it, 0 ) == WAIT_TIMEOUT;
+            }
+
+            if ( !running && replacements < MAX_ATTEMPTS * localWorkers )
+            {
+                replacements++;
+                startWorker( port, hashMegabytes, sharedName, processes );
+            }
+            else if ( !running )
+            {
+                std::cout << "All the local workers have gone, " << replacements << " replacements too, with " << units.size() - finished << " units unfinished" << std::endl;
+                failed = true;
+            }
+        }
+
+        if ( std::chrono::steady_clock::now() - lastProgress >= std::chrono::seconds( 10 ) )
+        {
+            lastProgress = std::chrono::steady_clock::now();
+
+            std::cout << "  " << finished << " of " << units.size() << " units finished, " << connections.size() << " workers" << std::endl;
+        }
+    }
+
+    // Tidy up - workers that don't see the quit see the connection close
+    for ( std::vector<Connection>::iterator it = connections.begin(); it != connections.end(); it++ )
+    {
+        sendLine( *it, "quit" );
+        closesocket( it->socket );
+    }
+
+    closesocket( listener );
+    WSACleanup();
+
+    for ( std::vector<void*>::const_iterator it = processes.cbegin(); it != processes.cend(); it++ )
+    {
+        WaitForSingleObject( *it, 5000 );
+        CloseHandle( *it );
+    }
+
+    if ( failed )
+    {
+        return false;
+    }
+
+    // Report
+    NodeCount nodes;
+    for ( size_t rootMove = 0; rootMove < rootMoves.size(); rootMove++ )
+    {
+        nodes += rootNodes[ rootMove ];
+
+        if ( divide )
+        {
+            Board::State undo = root->makeMove( rootMoves[ rootMove ] );
+            std::cout << "  " << rootMoves[ rootMove ].toString() << " : " << rootNodes[ rootMove ] << " " << root->toString() << std::endl;
+            root->unmakeMove( undo );
+        }
+    }
+
+    const double elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+    std::cout << "  Found " << nodes << " nodes in " << elapsed << "s (" << std::fixed << std::setprecision( 0 ) << ( elapsed == 0 ? 0 : nodes.toDouble() / elapsed ) << " nps)"
+              << std::defaultfloat << " from " << connected << " workers" << std::endl;
+    std::cout << "  Depth: " << depth << ". Actual: " << nodes << std::endl;
+
+    return true;
+}
+
+bool Distributed::work( const std::string& host, const std::string& port )
+{
+    WSADATA wsaData;
+    if ( WSAStartup( MAKEWORD( 2, 2 ), &wsaData ) != 0 )
+    {
+        std::cout << "Winsock was not started" << std::endl;
+        return false;
+    }
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    addrinfo* addresses = nullptr;
+    if ( getaddrinfo( host.c_str(), port.c_str(), &hints, &addresses ) != 0 )
+    {
+        std::cout << "Coordinator address not found: " << host << ":" << port << std::endl;
+        WSACleanup();
+        return false;
+    }
+
+    Connection connection { INVALID_SOCKET, "", NO_UNIT };
+
+    for ( addrinfo* address = addresses; address != nullptr && connection.socket == INVALID_SOCKET; address = address->ai_next )
+    {
+        connection.socket = socket( address->ai_family, address->ai_socktype, address->ai_protocol );
+
+        if ( connection.socket != INVALID_SOCKET && connect( connection.socket, address->ai_addr, static_cast<int>( address->ai_addrlen ) ) == SOCKET_ERROR )
+        {
+            closesocket( connection.socket );
+            connection.socket = INVALID_SOCKET;
+        }
+    }
+
+    freeaddrinfo( addresses );
+
+    if ( connection.socket == INVALID_SOCKET )
+    {
+        std::cout << "Coordinator not reached: " << host << ":" << port << std::endl;
+        WSACleanup();
+        return false;
+    }
+
+    unsigned long long searched = 0;
+    bool quit = false;
+
+    std::vector<std::string> lines;
+    while ( !quit && receiveLines( connection, lines ) )
+    {
+        for ( std::vector<std::string>::const_iterator it = lines.cbegin(); it != lines.cend() && !quit; it++ )
+        {
+            std::istringstream message( *it );
+
+            std::string word;
+            message >> word;
+
+            size_t id;
+            int depth;
+            if ( word == "unit" && message >> id >> depth )
+            {
+                std::string fen;
+                std::getline( message >> std::ws, fen );
+
+                std::stringstream result;
+                result << "result " << id << " " << Test::perftCount( depth, fen );
+
+                quit = !sendLine( connection, result.str() );
+                searched++;
+            }
+            else if ( word == "quit" )
+            {
+                quit = true;
+            }
+        }
+
+        lines.clear();
+    }
+
+    closesocket( connection.socket );
+    WSACleanup();
+
+    std::cout << "Worker: searched " << searched << " units" << std::endl;
+
+    return true;
+}
+
+bool Distributed::split( int depth, int splitPlies, const std::string& fen, unsigned int shards, const std::string& prefix )
+{
+    if ( depth < 1 )
+    {
+        std::cout << "Invalid depth: " << depth << std::endl;
+        return false;
+    }
+    else if ( shards < 1 )
+    {
+        std::cout << "Invalid number of shards: " << shards << std::endl;
+        return false;
+    }
+
+    std::cout << fen << std::endl;
+
+    std::unique_ptr<Board> root( Board::createBoard( fen ) );
+
+    std::vector<Move> rootMoves;
+    root->getMoves( rootMoves );
+
+    const int plies = std::max( 1, std::min( splitPlies, depth ) );
+
+    std::vector<Unit> units;
+    splitRoot( root.get(), rootMoves, plies, units );
+
+    // Bring the same position below different root moves together, to be written as one record
+    std::sort( units.begin(), units.end(), []( const Unit& a, const Unit& b ) { return a.key < b.key || ( a.key == b.key && a.rootMove < b.rootMove ); } );
+
+    // Records are dealt out in turn, and as they are in key order that shares them out at random. The split's id is
+    // an FNV-1a hash of every record, so that results from another split of the same search are told apart
+    std::vector<std::vector<std::string>> records( shards );
+    size_t recordCount = 0;
+    unsigned long long id = 0xCBF29CE484222325ull;
+
+    for ( std::vector<Unit>::const_iterator it = units.cbegin(); it != units.cend(); recordCount++ )
+    {
+        std::stringstream record;
+        record << "unit," << depth - plies << "," << it->fen << ",";
+
+        const unsigned long long key = it->key;
+        for ( std::vector<Unit>::const_iterator first = it; it != units.cend() && it->key == key; it++ )
+        {
+            record << ( it == first ? "" : " " ) << rootMoves[ it->rootMove ].toString() << ":" << it->paths;
+        }
+
+        const std::string text = record.str();
+        for ( std::string::const_iterator character = text.cbegin(); character != text.cend(); character++ )
+        {
+            id = ( id ^ static_cast<unsigned char>( *character ) ) * 0x100000001B3ull;
+        }
+
+        records[ recordCount % shards ].push_back( text );
+    }
+
+    std::vector<std::ofstream> files( shards );
+    for ( unsigned int shard = 0; shard < shards; shard++ )
+    {
+        const std::string filename = prefix + "." + std::to_string( shard ) + UNITS_EXTENSION;
+
+        files[ shard ].open( filename, std::ios::trunc );
+        if ( !files[ shard ].is_open() )
+        {
+            std::cout << "Units file was not opened: " << filename << std::endl;
+            return false;
+        }
+
+        writeHeader( files[ shard ], Header { depth, plies, shard, shards, records[ shard ].size(), id, fen } );
+
+        for ( std::vector<std::string>::const_iterator it = records[ shard ].cbegin(); it != records[ shard ].cend(); it++ )
+        {
+            files[ shard ] << *it << "\n";
+        }
+    }
+
+    for ( unsigned int shard = 0; shard < shards; shard++ )
+    {
+        files[ shard ].close();
+        if ( files[ shard ].fail() )
+        {
+            std::cout << "Units file was not written: " << prefix << "." << shard << UNITS_EXTENSION << std::endl;
+            return false;
+        }
+    }
+
+    std::cout << "  Split at ply " << plies << " into " << recordCount << " units (" << units.size() << " before merging) in " << shards << " files" << std::endl;
+
+    return true;
+}
+
+bool Distributed::runUnits( const std::string& filename )
+{
+    std::ifstream file( filename );
+    if ( !file.is_open() )
+    {
+        std::cout << "Units file was not opened: " << filename << std::endl;
+        return false;
+    }
+
+    Header header;
+    if ( !readHeader( file, filename, header ) )
+    {
+        return false;
+    }
+
+    std::cout << header.fen << std::endl;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::map<std::string, NodeCount> rootNodes;
+    unsigned long long searched = 0;
+
+    std::string line;
+    while ( std::getline( file, line ) )
+    {
+        // Without a newline the line was cut short
+        if ( file.eof() )
+        {
+            break;
+        }
+
+        // unit,depth,fen,moves
+        const size_t depthStart = line.find( ',' ) + 1;
+        const size_t fenStart = line.find( ',', depthStart ) + 1;
+        const size_t movesStart = line.find( ',', fenStart ) + 1;
+
+        if ( line.compare( 0, depthStart, "unit," ) != 0 || fenStart == 0 || movesStart == 0 )
+        {
+            std::cout << "Units file has a bad line: " << line << std::endl;
+            return false;
+        }
+
+        const int depth = atoi( line.substr( depthStart, fenStart - depthStart - 1 ).c_str() );
+        const unsigned long long nodes = Test::perftCount( depth, line.substr( fenStart, movesStart - fenStart - 1 ) );
+
+        std::istringstream moves( line.substr( movesStart ) );
+
+        std::string move;
+        while ( moves >> move )
+        {
+            const size_t colon = move.find( ':' );
+            if ( colon == std::string::npos )
+            {
+                std::cout << "Units file has a bad line: " << line << std::endl;
+                return false;
+            }
+
+            rootNodes[ move.substr( 0, colon ) ] += NodeCount::multiply( nodes, std::strtoull( move.c_str() + colon + 1, nullptr, 10 ) );
+        }
+
+        searched++;
+    }
+
+    if ( searched != header.units )
+    {
+        std::cout << "Units file is incomplete - " << searched << " of " << header.units << " units: " << filename << std::endl;
+        return false;
+    }
+
+    // The result goes next to the units
+    std::string resultFilename = filename;
+    if ( resultFilename.size() > UNITS_EXTENSION.size() && resultFilename.compare( resultFilename.size() - UNITS_EXTENSION.size(), UNITS_EXTENSION.size(), UNITS_EXTENSION ) == 0 )
+    {
+        resultFilename.erase( resultFilename.size() - UNITS_EXTENSION.size() );
+    }
+    resultFilename += RESULT_EXTENSION;
+
+    std::ofstream result( resultFilename, std::ios::trunc );
+
+    writeHeader( result, header );
+    for ( std::map<std::string, NodeCount>::const_iterator it = rootNodes.cbegin(); it != rootNodes.cend(); it++ )
+    {
+        result << "move," << it->first << "," << it->second << "\n";
+    }
+    result << "done," << searched << "\n";
+
+    result.close();
+    if ( result.fail() )
+    {
+        std::cout << "Result file was not written: " << resultFilename << std::endl;
+        return false;
+    }
+
+    const double elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+    std::cout << "  Searched " << searched << " units in " << elapsed << "s, written to " << resultFilename << std::endl;
+
+    return true;
+}
+
+bool Distributed::reduce( const std::vector<std::string>& filenames )
+{
+    if ( filenames.empty() )
+    {
+        std::cout << "No result files" << std::endl;
+        return false;
+    }
+
+    Header split;
+    std::vector<bool> reduced;
+    std::map<std::string, NodeCount> rootNodes;
+
+    for ( std::vector<std::string>::const_iterator it = filenames.cbegin(); it != filenames.cend(); it++ )
+    {
+        std::ifstream file( *it );
+        if ( !file.is_open() )
+        {
+            std::cout << "Result file was not opened: " << *it << std::endl;
+            return false;
+        }
+
+        Header header;
+        if ( !readHeader( file, *it, header ) )
+        {
+            return false;
+        }
+
+        if ( it == filenames.cbegin() )
+        {
+            split = header;
+            reduced.assign( split.shards, false );
+        }
+        else if ( header.depth != split.depth || header.plies != split.plies || header.shards != split.shards || header.split != split.split || header.fen != split.fen )
+        {
+            std::cout << "Result file is from a different split: " << *it << std::endl;
+            return false;
+        }
+
+        if ( reduced[ header.shard ] )
+        {
+            std::cout << "Result file repeats shard " << header.shard << ": " << *it << std::endl;
+            return false;
+        }
+
+        bool done = false;
+
+        std::string line;
+        while ( !done && std::getline( file, line ) )
+        {
+            const size_t comma = line.find_last_of( ',' );
+
+            NodeCount nodes;
+            if ( line.compare( 0, 5, "move," ) == 0 && comma > 5 && NodeCount::parse( line.substr( comma + 1 ), nodes ) )
+            {
+                rootNodes[ line.substr( 5, comma - 5 ) ] += nodes;
+            }
+            else
+            {
+                // Every unit in the shard was searched
+                done = line.compare( 0, 5, "done," ) == 0 && !file.eof() && std::strtoull( line.c_str() + 5, nullptr, 10 ) == header.units;
+            }
+        }
+
+        if ( !done )
+        {
+            std::cout << "Result file is incomplete: " << *it << std::endl;
+            return false;
+        }
+
+        reduced[ header.shard ] = true;
+    }
+
+    bool complete = true;
+    for ( unsigned int shard = 0; shard < split.shards; shard++ )
+    {
+        if ( !reduced[ shard ] )
+        {
+            std::cout << "Result missing for shard " << shard << std::endl;
+            complete = false;
+        }
+    }
+
+    if ( !complete )
+    {
+        return false;
+    }
+
+    std::cout << split.fen << std::endl;
+
+    // Report in the generator's order, as divide does
+    std::unique_ptr<Board> root( Board::createBoard( split.fen ) );
+
+    std::vector<Move> rootMoves;
+    root->getMoves( rootMoves );
+
+    size_t known = 0;
+    for ( std::vector<Move>::const_iterator it = rootMoves.cbegin(); it != rootMoves.cend(); it++ )
+    {
+        known += rootNodes.count( it->toString() );
+    }
+
+    if ( known != rootNodes.size() )
+    {
+        std::cout << "Result files have moves that aren't legal in the root position" << std::endl;
+        return false;
+    }
+
+    NodeCount nodes;
+    for ( std::vector<Move>::const_iterator it = rootMoves.cbegin(); it != rootMoves.cend(); it++ )
+    {
+        const NodeCount& moveNodes = rootNodes[ it->toString() ];
+        nodes += moveNodes;
+
+        Board::State undo = root->makeMove( *it );
+        std::cout << "  " << it->toString() << " : " << moveNodes << " " << root->toString() << std::endl;
+        root->unmakeMove( undo );
+    }
+
+    std::cout << "  Depth: " << split.depth << ". Actual: " << nodes << std::endl;
+
+    return true;
+}
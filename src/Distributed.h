@@ -0,0 +1,157 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Board.h"
+
+/// <summary>
+/// One perft spread over worker processes, on this machine or others, that connect to a coordinator over TCP.
+/// The coordinator expands the root to the split ply, merging identical positions below each root move into one
+/// work unit along with the number of paths to it, and hands the units out one at a time to whichever workers are
+/// idle. Each worker searches its units with Test's usual depth-first search, so -hash and the like apply there.
+/// The protocol is text, a line per message:
+///   coordinator to worker: "unit [id] [depth] [fen]" and "quit"
+///   worker to coordinator: "result [id] [nodes]"
+/// A unit held by a worker that disconnects is handed out again, up to MAX_ATTEMPTS times in all, and a local
+/// worker is started to replace it.
+/// The same split can be done offline for a batch scheduler instead, into files of units that are each searched by
+/// a separate run and then reduced. Those files are text, with fields separated by commas as FEN strings have none:
+///   every file starts "root,[depth],[plies],[shard],[shards],[units],[split],[fen]" for the whole search, with the
+///   split ply, the number of units in the shard and an id for the split - a hash of all its units, in hex
+///   a units file then has "unit,[depth],[fen],[move]:[paths] ..." for each position, with the root moves it is
+///   below and the number of paths to it under each - identical positions are merged across all the root moves
+///   a result file then has "move,[move],[nodes]" for each root move and ends "done,[units]"
+/// </summary>
+class Distributed
+{
+private:
+    struct Unit
+    {
+        size_t rootMove;
+        unsigned long long key;
+        std::string fen;
+        unsigned long long paths;
+        int attempts;
+        bool finished;
+    };
+
+    // A worker's socket and any of its text that isn't a whole line yet - defined with the socket code
+    struct Connection;
+
+    /// <summary>
+    /// The first line of a units or result file
+    /// </summary>
+    struct Header
+    {
+        int depth;
+        int plies;
+        unsigned int shard;
+        unsigned int shards;
+        unsigned long long units;
+        unsigned long long split;
+        std::string fen;
+    };
+
+    static const int MAX_ATTEMPTS;
+    static const size_t NO_UNIT;
+
+    static const std::string UNITS_EXTENSION;
+    static const std::string RESULT_EXTENSION;
+
+    /// <summary>
+    /// Expand a position to the split ply, adding each position there as a unit or to the paths of the unit that
+    /// already has it
+    /// </summary>
+    /// <param name="plies">plies still to expand</param>
+    /// <param name="board">the position</param>
+    /// <param name="rootMove">the root move this position is below</param>
+    /// <param name="units">the units</param>
+    /// <param name="found">the units below this root move so far, by key</param>
+    static void expand( int plies, Board* board, size_t rootMove, std::vector<Unit>& units, std::unordered_map<unsigned long long, size_t>& found );
+
+    /// <summary>
+    /// Split the tree below each root move into units, merging identical positions below the same root move
+    /// </summary>
+    /// <param name="root">the root position</param>
+    /// <param name="rootMoves">the root position's moves</param>
+    /// <param name="plies">the ply to split at, at least 1</param>
+    /// <param name="units">receives the units</param>
+    static void splitRoot( Board* root, const std::vector<Move>& rootMoves, int plies, std::vector<Unit>& units );
+
+    /// <summary>
+    /// Read the first line of a units or result file, reporting it if it can't be read
+    /// </summary>
+    static bool readHeader( std::istream& file, const std::string& filename, Header& header );
+
+    static void writeHeader( std::ostream& file, const Header& header );
+
+    static bool sendLine( Connection& connection, const std::string& line );
+
+    /// <summary>
+    /// Read what has arrived on a connection, blocking until something has
+    /// </summary>
+    /// <param name="connection">the connection</param>
+    /// <param name="lines">receives the whole lines read, without their newlines</param>
+    /// <returns><code>false</code> if the connection is closed or fails</returns>
+    static bool receiveLines( Connection& connection, std::vector<std::string>& lines );
+
+    /// <summary>
+    /// Start a worker process on this machine, without a console, connected to the coordinator
+    /// </summary>
+    static bool startWorker( unsigned short port, size_t hashMegabytes, const std::string& sharedName, std::vector<void*>& processes );
+
+public:
+    /// <summary>
+    /// Run a perft as the coordinator, starting local workers and accepting remote ones, and report the total and
+    /// optionally the count below each root move
+    /// </summary>
+    /// <param name="depth">the search depth</param>
+    /// <param name="fen">the FEN string</param>
+    /// <param name="splitPlies">the ply to split the tree into units at, at most the depth</param>
+    /// <param name="listenAddress">the IPv4 address to listen for workers on, or empty for the loopback address when
+    /// there are local workers and every address otherwise</param>
+    /// <param name="port">the port to listen for workers on</param>
+    /// <param name="localWorkers">workers to start on this machine, or 0 to wait for remote ones</param>
+    /// <param name="hashMegabytes">the table size for local workers, or 0 for none</param>
+    /// <param name="sharedName">the shared table for local workers, or empty for a table each</param>
+    /// <param name="divide">true to report the count below each root move</param>
+    /// <returns><code>false</code> if the run can't be started or a unit fails too often</returns>
+    static bool coordinate( int depth, const std::string& fen, int splitPlies, const std::string& listenAddress, unsigned short port, unsigned int localWorkers, size_t hashMegabytes, const std::string& sharedName, bool divide );
+
+    /// <summary>
+    /// Split a search into units at a ply and write them to files, ready for runUnits. The files are named
+    /// [prefix].[shard].units
+    /// </summary>
+    /// <param name="depth">the search depth</param>
+    /// <param name="splitPlies">the ply to split the tree into units at, at most the depth</param>
+    /// <param name="fen">the FEN string</param>
+    /// <param name="shards">the number of files to share the units between</param>
+    /// <param name="prefix">the start of the file names</param>
+    /// <returns><code>false</code> if a file can't be written</returns>
+    static bool split( int depth, int splitPlies, const std::string& fen, unsigned int shards, const std::string& prefix );
+
+    /// <summary>
+    /// Search the units in a file and write the count below each root move to a result file, named as the units
+    /// file but ending .result. Each unit is searched with Test's usual depth-first search, so -hash and the like apply
+    /// </summary>
+    /// <param name="filename">the units file</param>
+    /// <returns><code>false</code> if a file can't be read or written</returns>
+    static bool runUnits( const std::string& filename );
+
+    /// <summary>
+    /// Add up the result files of a split and report the count below each root move and the total
+    /// </summary>
+    /// <param name="filenames">a result file for every shard of the split</param>
+    /// <returns><code>false</code> if a file is missing, incomplete or from a different split</returns>
+    static bool reduce( const std::vector<std::string>& filenames );
+
+    /// <summary>
+    /// Run as a worker, searching the units from a coordinator until it says to quit or goes away
+    /// </summary>
+    /// <param name="host">the coordinator's host name or address</param>
+    /// <param name="port">the coordinator's port</param>
+    /// <returns><code>false</code> if the coordinator can't be reached</returns>
+    static bool work( const std::string& host, const std::string& port );
+};
@@ -1,3 +1,92 @@
 #include "Fen.h"
 
+#include <cstring>
+#include <vector>
+
 const char* Fen::startingPosition = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+bool Fen::isValid( const std::string& fen )
+{
+    std::vector<std::string> fields;
+
+    size_t start = fen.find_first_not_of( ' ' );
+    while ( start != std::string::npos )
+    {
+        const size_t end = fen.find( ' ', start );
+        fields.push_back( fen.substr( start, end == std::string::npos ? std::string::npos : end - start ) );
+        start = fen.find_first_not_of( ' ', end );
+    }
+
+    if ( fields.size() < 4 || fields.size() > 6 )
+    {
+        return false;
+    }
+
+    int ranks = 1;
+    int files = 0;
+    int whiteKings = 0;
+    int blackKings = 0;
+
+    for ( std::string::const_iterator it = fields[ 0 ].cbegin(); it != fields[ 0 ].cend(); it++ )
+    {
+        if ( *it == '/' )
+        {
+            if ( files != 8 )
+            {
+                return false;
+            }
+
+            ranks++;
+            files = 0;
+        }
+        else if ( *it >= '1' && *it <= '8' )
+        {
+            files += *it - '0';
+        }
+        else if ( strchr( "pnbrqkPNBRQK", *it ) != nullptr )
+        {
+            whiteKings += *it == 'K';
+            blackKings += *it == 'k';
+            files++;
+        }
+        else
+        {
+            return false;
+        }
+
+        if ( files > 8 )
+        {
+            return false;
+        }
+    }
+
+    if ( ranks != 8 || files != 8 || whiteKings != 1 || blackKings != 1 )
+    {
+        return false;
+    }
+
+    if ( fields[ 1 ] != "w" && fields[ 1 ] != "b" )
+    {
+        return false;
+    }
+
+    if ( fields[ 2 ] != "-" && ( fields[ 2 ].size() > 4 || fields[ 2 ].find_first_not_of( "KQkq" ) != std::string::npos ) )
+    {
+        return false;
+    }
+
+    if ( fields[ 3 ] != "-" && ( fields[ 3 ].size() != 2 || fields[ 3 ][ 0 ] < 'a' || fields[ 3 ][ 0 ] > 'h' || ( fields[ 3 ][ 1 ] != '3' && fields[ 3 ][ 1 ] != '6' ) ) )
+    {
+        return false;
+    }
+
+    for ( std::vector<std::string>::const_iterator it = fields.cbegin() + 4; it != fields.cend(); it++ )
+    {
+        if ( it->find_first_not_of( "0123456789" ) != std::string::npos )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -1,8 +1,17 @@
 #pragma once
 
+#include <string>
+
 class Fen
 {
 public:
     static const char* startingPosition;
-};
 
+    /// <summary>
+    /// Check a FEN string closely enough that creating a board from it is safe - the pieces, side to move, castling
+    /// rights and en passant square are all there and well formed, and there is one king of each color
+    /// </summary>
+    /// <param name="fen">the FEN string</param>
+    /// <returns><code>true</code> if a board can be created from it</returns>
+    static bool isValid( const std::string& fen );
+};
@@ -3,14 +3,27 @@
 #include <iostream>
 #include <sstream>
 
-const unsigned long Move::PROMOTION_MASK = 0b00000000000000000111000000000000;
-const unsigned long Move::KNIGHT         = 0b00000000000000000100000000000000;
-const unsigned long Move::BISHOP         = 0b00000000000000000101000000000000;
-const unsigned long Move::ROOK           = 0b00000000000000000110000000000000;
-const unsigned long Move::QUEEN          = 0b00000000000000000111000000000000;
-
-Move::Move( unsigned long from, unsigned long to, unsigned long promotion ) :
-    moveBits( ( from << 6 ) | to | promotion )
+const unsigned short Move::QUIET;
+const unsigned short Move::DOUBLE_PAWN_PUSH;
+const unsigned short Move::KINGSIDE_CASTLE;
+const unsigned short Move::QUEENSIDE_CASTLE;
+const unsigned short Move::CAPTURE;
+const unsigned short Move::EN_PASSANT_CAPTURE;
+const unsigned short Move::KNIGHT_PROMOTION;
+const unsigned short Move::BISHOP_PROMOTION;
+const unsigned short Move::ROOK_PROMOTION;
+const unsigned short Move::QUEEN_PROMOTION;
+const unsigned short Move::KNIGHT_PROMOTION_CAPTURE;
+const unsigned short Move::BISHOP_PROMOTION_CAPTURE;
+const unsigned short Move::ROOK_PROMOTION_CAPTURE;
+const unsigned short Move::QUEEN_PROMOTION_CAPTURE;
+
+const unsigned short Move::PROMOTION_FLAG;
+const unsigned short Move::CAPTURE_FLAG;
+const unsigned short Move::PROMOTION_PIECE_MASK;
+
+Move::Move( unsigned short from, unsigned short to, unsigned short flags ) :
+    moveBits( ( flags << 12 ) | ( from << 6 ) | to )
 {
 //    std::cerr << "From: " << std::hex << from << ". To: " << std::hex << to << ". Move: " << toString() << std::endl;
 }
@@ -23,27 +36,12 @@ std::string Move::toString() const
     unsigned char fromFile = ( moveBits >> 6 ) & 0b00000111;
     unsigned char toRank = ( moveBits >> 3 ) & 0b00000111;
     unsigned char toFile = ( moveBits ) & 0b00000111;
-    unsigned long promotion = moveBits & PROMOTION_MASK;
 
     move << (char) ( 'a' + fromFile ) << (char) ( '1' + fromRank ) << (char) ( 'a' + toFile ) << (char) ( '1' + toRank );
 
-    switch ( promotion )
+    if ( isPromotion() )
     {
-        case KNIGHT:
-            move << "n";
-            break;
-
-        case BISHOP:
-            move << "b";
-            break;
-
-        case ROOK:
-            move << "r";
-            break;
-
-        case QUEEN:
-            move << "q";
-            break;
+        move << "nbrq"[ getFlags() & PROMOTION_PIECE_MASK ];
     }
 
     return move.str();
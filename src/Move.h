@@ -2,19 +2,38 @@
 
 #include <string>
 
+/// <summary>
+/// A move packed into 16 bits - 6 bits "to", 6 bits "from" and a 4 bit move type flag.
+/// The flag lets the generators tell applyMove what kind of move this is so it doesn't need to work it out again
+/// </summary>
 class Move
 {
 private:
-    unsigned long moveBits;
+    unsigned short moveBits;
 
 public:
-    static const unsigned long PROMOTION_MASK;
-    static const unsigned long KNIGHT;
-    static const unsigned long BISHOP;
-    static const unsigned long ROOK;
-    static const unsigned long QUEEN;
+    // Move type flags (top 4 bits). Bit 3 marks a promotion and bit 2 a capture, so the promotion
+    // piece is in the bottom two bits and a promotion capture is a promotion with the capture bit set
+    static const unsigned short QUIET                    = 0b0000;
+    static const unsigned short DOUBLE_PAWN_PUSH         = 0b0001;
+    static const unsigned short KINGSIDE_CASTLE          = 0b0010;
+    static const unsigned short QUEENSIDE_CASTLE         = 0b0011;
+    static const unsigned short CAPTURE                  = 0b0100;
+    static const unsigned short EN_PASSANT_CAPTURE       = 0b0101;
+    static const unsigned short KNIGHT_PROMOTION         = 0b1000;
+    static const unsigned short BISHOP_PROMOTION         = 0b1001;
+    static const unsigned short ROOK_PROMOTION           = 0b1010;
+    static const unsigned short QUEEN_PROMOTION          = 0b1011;
+    static const unsigned short KNIGHT_PROMOTION_CAPTURE = 0b1100;
+    static const unsigned short BISHOP_PROMOTION_CAPTURE = 0b1101;
+    static const unsigned short ROOK_PROMOTION_CAPTURE   = 0b1110;
+    static const unsigned short QUEEN_PROMOTION_CAPTURE  = 0b1111;
 
-    Move( unsigned long from, unsigned long to, unsigned long promotion = 0 );
+    static const unsigned short PROMOTION_FLAG           = 0b1000;
+    static const unsigned short CAPTURE_FLAG             = 0b0100;
+    static const unsigned short PROMOTION_PIECE_MASK     = 0b0011;
+
+    Move( unsigned short from, unsigned short to, unsigned short flags = QUIET );
 
     inline unsigned short getFrom() const
     {
@@ -26,11 +45,20 @@ public:
         return moveBits & 0b0000000000111111;
     }
 
-    inline unsigned long getPromotion() const
+    inline unsigned short getFlags() const
+    {
+        return moveBits >> 12;
+    }
+
+    inline bool isCapture() const
     {
-        return moveBits & PROMOTION_MASK;
+        return getFlags() & CAPTURE_FLAG;
+    }
+
+    inline bool isPromotion() const
+    {
+        return getFlags() & PROMOTION_FLAG;
     }
 
     std::string toString() const;
 };
-
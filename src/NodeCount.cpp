@@ -0,0 +1,103 @@
+#include "NodeCount.h"
+
+#include <algorithm>
+#include <cctype>
+#include <intrin.h>
+
+NodeCount& NodeCount::operator+=( const NodeCount& other )
+{
+    unsigned char carry = _addcarry_u64( 0, low, other.low, &low );
+    _addcarry_u64( carry, high, other.high, &high );
+
+    return *this;
+}
+
+NodeCount NodeCount::multiply( unsigned long long a, unsigned long long b )
+{
+    NodeCount product;
+    product.low = _umul128( a, b, &product.high );
+
+    return product;
+}
+
+std::string NodeCount::toString() const
+{
+    if ( high == 0 )
+    {
+        return std::to_string( low );
+    }
+
+    // Long division by 10 a 32 bit limb at a time, most significant first, for each digit
+    unsigned long long limbs[ 4 ] = { high >> 32, high & 0xFFFFFFFF, low >> 32, low & 0xFFFFFFFF };
+
+    std::string digits;
+    while ( limbs[ 0 ] != 0 || limbs[ 1 ] != 0 || limbs[ 2 ] != 0 || limbs[ 3 ] != 0 )
+    {
+        unsigned long long remainder = 0;
+        for ( int index = 0; index < 4; index++ )
+        {
+            const unsigned long long value = ( remainder << 32 ) | limbs[ index ];
+            limbs[ index ] = value / 10;
+            remainder = value % 10;
+        }
+
+        digits.push_back( static_cast<char>( '0' + remainder ) );
+    }
+
+    std::reverse( digits.begin(), digits.end() );
+
+    return digits;
+}
+
+bool NodeCount::parse( const std::string& text, NodeCount& count )
+{
+    count = NodeCount();
+
+    std::string::const_iterator it = text.cbegin();
+    while ( it != text.cend() && isspace( static_cast<unsigned char>( *it ) ) )
+    {
+        it++;
+    }
+
+    if ( it == text.cend() || !isdigit( static_cast<unsigned char>( *it ) ) )
+    {
+        return false;
+    }
+
+    for ( ; it != text.cend() && isdigit( static_cast<unsigned char>( *it ) ); it++ )
+    {
+        // count = count * 10 + digit, failing if anything carries out of the top
+        unsigned long long lowCarry;
+        unsigned long long highCarry;
+
+        const unsigned long long low = _umul128( count.low, 10, &lowCarry );
+        const unsigned long long high = _umul128( count.high, 10, &highCarry );
+
+        NodeCount next;
+        next.low = low;
+        next.high = high + lowCarry;
+
+        if ( highCarry != 0 || next.high < high )
+        {
+            count = NodeCount();
+            return false;
+        }
+
+        next += NodeCount( *it - '0' );
+
+        if ( next.high < high + lowCarry )
+        {
+            count = NodeCount();
+            return false;
+        }
+
+        count = next;
+    }
+
+    return true;
+}
+
+std::ostream& operator<<( std::ostream& stream, const NodeCount& count )
+{
+    return stream << count.toString();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+/// <summary>
+/// A 128 bit unsigned node count, for totals that can go past 64 bits - the start position passes 2^64 leaf
+/// nodes at depth 14. Searches count in 64 bits below the root and only the root totals are added up in this
+/// </summary>
+class NodeCount
+{
+private:
+    unsigned long long low;
+    unsigned long long high;
+
+public:
+    NodeCount( unsigned long long value = 0 ) :
+        low( value ),
+        high( 0 )
+    {
+    }
+
+    NodeCount& operator+=( const NodeCount& other );
+
+    /// <summary>
+    /// The full 128 bit product of two 64 bit counts
+    /// </summary>
+    static NodeCount multiply( unsigned long long a, unsigned long long b );
+
+    bool operator==( const NodeCount& other ) const
+    {
+        return low == other.low && high == other.high;
+    }
+
+    bool operator!=( const NodeCount& other ) const
+    {
+        return !( *this == other );
+    }
+
+    /// <summary>
+    /// Returns true if the count doesn't fit in 64 bits
+    /// </summary>
+    bool isWide() const
+    {
+        return high != 0;
+    }
+
+    /// <summary>
+    /// The low 64 bits, which is the whole count unless it is wide
+    /// </summary>
+    unsigned long long getLow() const
+    {
+        return low;
+    }
+
+    double toDouble() const
+    {
+        return static_cast<double>( high ) * 18446744073709551616.0 + static_cast<double>( low );
+    }
+
+    std::string toString() const;
+
+    /// <summary>
+    /// Read a count from the leading digits of a string, after any leading white space
+    /// </summary>
+    /// <param name="text">the text</param>
+    /// <param name="count">receives the count, or 0 if there is none</param>
+    /// <returns><code>false</code> if there are no digits or the number doesn't fit in 128 bits</returns>
+    static bool parse( const std::string& text, NodeCount& count );
+};
+
+std::ostream& operator<<( std::ostream& stream, const NodeCount& count );
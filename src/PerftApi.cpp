@@ -0,0 +1,364 @@
+#include "PerftApi.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AttackMap.h"
+#include "BitBoard.h"
+#include "Board.h"
+#include "Fen.h"
+#include "PerftTable.h"
+#include "Zobrist.h"
+
+struct PerftBoard
+{
+    Board board;
+};
+
+struct PerftSearch
+{
+    unsigned int threads;
+    std::unique_ptr<PerftTable> table;
+};
+
+static std::once_flag initialized;
+
+/// <summary>
+/// Set up the tables the generator uses, the first time any board is created
+/// </summary>
+static void initialize()
+{
+    std::call_once( initialized, []
+    {
+        BitBoard::initialize();
+        Zobrist::initialize();
+        AttackMap::initialize();
+    } );
+}
+
+static void toPerftMove( const Move& move, PerftMove& perftMove )
+{
+    const std::string text = move.toString();
+
+    perftMove.from = static_cast<unsigned char>( move.getFrom() );
+    perftMove.to = static_cast<unsigned char>( move.getTo() );
+    perftMove.promotion = move.isPromotion() ? text[ 4 ] : 0;
+
+    text.copy( perftMove.text, sizeof( perftMove.text ) - 1 );
+    perftMove.text[ text.size() ] = 0;
+}
+
+/// <summary>
+/// The depth-first search, as in Test but with the table passed in rather than shared
+/// </summary>
+static unsigned long long perftLoop( int depth, Board* board, PerftTable* table )
+{
+    if ( depth == 0 )
+    {
+        return 1;
+    }
+
+    const bool lookedUp = table != nullptr && depth >= 2;
+    unsigned long long nodes = 0;
+
+    if ( lookedUp && table->find( board->getZobristKey(), depth, nodes ) )
+    {
+        return nodes;
+    }
+
+    std::vector<Move> moves;
+    moves.reserve( 256 );
+
+    board->getMoves( moves );
+
+    for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+    {
+        Board::State undo = board->makeMove( *it );
+        nodes += perftLoop( depth - 1, board, table );
+        board->unmakeMove( undo );
+    }
+
+    if ( lookedUp )
+    {
+        table->store( board->getZobristKey(), depth, nodes );
+    }
+
+    return nodes;
+}
+
+/// <summary>
+/// Count the leaf nodes below each root move, sharing the root moves out between the search's threads
+/// </summary>
+/// <param name="search">the search</param>
+/// <param name="root">the root position</param>
+/// <param name="depth">the search depth, at least 1</param>
+/// <param name="moves">receives the root moves</param>
+/// <param name="counts">receives the count for each root move</param>
+static void divideRoot( PerftSearch* search, const Board& root, int depth, std::vector<Move>& moves, std::vector<unsigned long long>& counts )
+{
+    Board board = root;
+    board.getMoves( moves );
+    counts.assign( moves.size(), 0 );
+
+    std::atomic<size_t> nextMove( 0 );
+
+    auto work = [ & ]()
+    {
+        Board position = root;
+
+        for ( size_t move = nextMove++; move < moves.size(); move = nextMove++ )
+        {
+            Board::State undo = position.makeMove( moves[ move ] );
+            counts[ move ] = perftLoop( depth - 1, &position, search->table.get() );
+            position.unmakeMove( undo );
+        }
+    };
+
+    // The table isn't safe to share, so with one in use the calling thread does it all
+    const unsigned int threadCount = search->table ? 1 : static_cast<unsigned int>( std::min<size_t>( search->threads, moves.size() ) );
+
+    std::vector<std::thread> threads;
+    for ( unsigned int thread = 1; thread < threadCount; thread++ )
+    {
+        threads.emplace_back( work );
+    }
+
+    work();
+
+    for ( std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); it++ )
+    {
+        it->join();
+    }
+}
+
+unsigned int perft_get_api_version( void )
+{
+    return PERFT_API_VERSION;
+}
+
+PerftResult perft_board_create( const char* fen, PerftBoard** board )
+{
+    if ( board == nullptr )
+    {
+        return PERFT_INVALID_ARGUMENT;
+    }
+
+    *board = nullptr;
+
+    const std::string text = fen == nullptr ? Fen::startingPosition : fen;
+    if ( !Fen::isValid( text ) )
+    {
+        return PERFT_INVALID_FEN;
+    }
+
+    try
+    {
+        initialize();
+
+        std::unique_ptr<Board> created( Board::createBoard( text ) );
+        *board = new PerftBoard{ *created };
+    }
+    catch ( const std::bad_alloc& )
+    {
+        return PERFT_OUT_OF_MEMORY;
+    }
+
+    return PERFT_OK;
+}
+
+void perft_board_destroy( PerftBoard* board )
+{
+    delete board;
+}
+
+PerftResult perft_board_get_fen( const PerftBoard* board, char* buffer, size_t size )
+{
+    if ( board == nullptr || buffer == nullptr )
+    {
+        return PERFT_INVALID_ARGUMENT;
+    }
+
+    const std::string fen = board->board.toString();
+
+    if ( fen.size() >= size )
+    {
+        return PERFT_BUFFER_TOO_SMALL;
+    }
+
+    fen.copy( buffer, fen.size() );
+    buffer[ fen.size() ] = 0;
+
+    return PERFT_OK;
+}
+
+PerftResult perft_board_make_move( PerftBoard* board, const char* move )
+{
+    if ( board == nullptr || move == nullptr )
+    {
+        return PERFT_INVALID_ARGUMENT;
+    }
+
+    std::vector<Move> moves;
+    moves.reserve( 256 );
+
+    board->board.getMoves( moves );
+
+    for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+    {
+        if ( it->toString() == move )
+        {
+            board->board.makeMove( *it );
+            return PERFT_OK;
+        }
+    }
+
+    return PERFT_ILLEGAL_MOVE;
+}
+
+PerftResult perft_board_get_moves( const PerftBoard* board, PerftMove* moves, size_t capacity, size_t* count )
+{
+    if ( board == nullptr || count == nullptr || ( moves == nullptr && capacity > 0 ) )
+    {
+        return PERFT_INVALID_ARGUMENT;
+    }
+
+    Board position = board->board;
+
+    std::vector<Move> legalMoves;
+    legalMoves.reserve( 256 );
+
+    position.getMoves( legalMoves );
+
+    *count = legalMoves.size();
+
+    for ( size_t index = 0; index < legalMoves.size() && index < capacity; index++ )
+    {
+        toPerftMove( legalMoves[ index ], moves[ index ] );
+    }
+
+    return legalMoves.size() > capacity ? PERFT_BUFFER_TOO_SMALL : PERFT_OK;
+}
+
+PerftResult perft_search_create( const PerftOptions* options, PerftSearch** search )
+{
+    if ( search == nullptr || ( options != nullptr && options->threads == 0 ) )
+    {
+        return PERFT_INVALID_ARGUMENT;
+    }
+
+    *search = nullptr;
+
+    try
+    {
+        initialize();
+
+        std::unique_ptr<PerftSearch> created( new PerftSearch() );
+        created->threads = options == nullptr ? 1 : options->threads;
+
+        if ( options != nullptr && options->hashMegabytes > 0 )
+        {
+            created->table.reset( new PerftTable( options->hashMegabytes ) );
+        }
+
+        *search = created.release();
+    }
+    catch ( const std::bad_alloc& )
+    {
+        return PERFT_OUT_OF_MEMORY;
+    }
+
+    return PERFT_OK;
+}
+
+void perft_search_destroy( PerftSearch* search )
+{
+    delete search;
+}
+
+PerftResult perft_search_perft( PerftSearch* search, const PerftBoard* board, int depth, unsigned long long* nodes )
+{
+    if ( search == nullptr || board == nullptr || depth < 0 || nodes == nullptr )
+    {
+        return PERFT_INVALID_ARGUMENT;
+    }
+
+    *nodes = 0;
+
+    try
+    {
+        if ( depth == 0 || search->threads == 1 )
+        {
+            Board position = board->board;
+            *nodes = perftLoop( depth, &position, search->table.get() );
+        }
+        else
+        {
+            std::vector<Move> moves;
+            std::vector<unsigned long long> counts;
+
+            divideRoot( search, board->board, depth, moves, counts );
+
+            for ( std::vector<unsigned long long>::const_iterator it = counts.cbegin(); it != counts.cend(); it++ )
+            {
+                *nodes += *it;
+            }
+        }
+    }
+    catch ( const std::bad_alloc& )
+    {
+        return PERFT_OUT_OF_MEMORY;
+    }
+
+    return PERFT_OK;
+}
+
+PerftResult perft_search_divide( PerftSearch* search, const PerftBoard* board, int depth, PerftDivide* entries, size_t capacity, size_t* count, unsigned long long* nodes )
+{
+    if ( search == nullptr || board == nullptr || depth < 0 || count == nullptr || nodes == nullptr || ( entries == nullptr && capacity > 0 ) )
+    {
+        return PERFT_INVALID_ARGUMENT;
+    }
+
+    *count = 0;
+    *nodes = 0;
+
+    if ( depth == 0 )
+    {
+        *nodes = 1;
+        return PERFT_OK;
+    }
+
+    try
+    {
+        std::vector<Move> moves;
+        std::vector<unsigned long long> counts;
+
+        divideRoot( search, board->board, depth, moves, counts );
+
+        *count = moves.size();
+
+        for ( size_t index = 0; index < moves.size(); index++ )
+        {
+            *nodes += counts[ index ];
+
+            if ( index < capacity )
+            {
+                toPerftMove( moves[ index ], entries[ index ].move );
+                entries[ index ].nodes = counts[ index ];
+            }
+        }
+
+        return moves.size() > capacity ? PERFT_BUFFER_TOO_SMALL : PERFT_OK;
+    }
+    catch ( const std::bad_alloc& )
+    {
+        return PERFT_OUT_OF_MEMORY;
+    }
+}
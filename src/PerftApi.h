@@ -0,0 +1,120 @@
+#pragma once
+
+/*
+ * C API for the perft library (perftlib.dll), for calling perft in-process rather than running perft.exe and
+ * reading its output. Nothing here writes to the console - every function reports through its return value.
+ *
+ * Boards and searches are handles that the caller creates and destroys. A board is only read by a search, so one
+ * board can be searched by several searches at once. A search keeps its transposition table from call to call, so
+ * the same search should be reused for related positions - but only one call at a time may use a given search.
+ *
+ * Squares are numbered 0 (a1) to 63 (h8), rank by rank. Moves are also given as text in long algebraic notation,
+ * as in "e2e4" or "e7e8q".
+ */
+
+#include <stddef.h>
+
+#ifdef PERFT_EXPORTS
+#define PERFT_API __declspec( dllexport )
+#else
+#define PERFT_API __declspec( dllimport )
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Changes only when the API does, so that a caller can check it was built against this header */
+#define PERFT_API_VERSION 1
+
+typedef enum PerftResult
+{
+    PERFT_OK = 0,
+    PERFT_INVALID_ARGUMENT = 1,     /* a null pointer, a negative depth or a zero thread count */
+    PERFT_INVALID_FEN = 2,
+    PERFT_ILLEGAL_MOVE = 3,
+    PERFT_BUFFER_TOO_SMALL = 4,     /* the count needed is still given */
+    PERFT_OUT_OF_MEMORY = 5
+} PerftResult;
+
+typedef struct PerftBoard PerftBoard;
+typedef struct PerftSearch PerftSearch;
+
+typedef struct PerftMove
+{
+    unsigned char from;
+    unsigned char to;
+    char promotion;                 /* 'n', 'b', 'r' or 'q', or 0 if not a promotion */
+    char text[ 6 ];                 /* long algebraic, null terminated */
+} PerftMove;
+
+typedef struct PerftDivide
+{
+    PerftMove move;
+    unsigned long long nodes;       /* leaf nodes below the move */
+} PerftDivide;
+
+typedef struct PerftOptions
+{
+    unsigned int threads;           /* threads to share the root moves between, 1 to search on the calling thread */
+    size_t hashMegabytes;           /* transposition table size, or 0 for none. The table isn't shared between
+                                       threads, so a search with a table uses just one of them */
+} PerftOptions;
+
+/*
+ * Returns PERFT_API_VERSION as the library was built
+ */
+PERFT_API unsigned int perft_get_api_version( void );
+
+/*
+ * Create a board from a FEN string, or the start position if fen is null. The board is destroyed with
+ * perft_board_destroy
+ */
+PERFT_API PerftResult perft_board_create( const char* fen, PerftBoard** board );
+
+/*
+ * Destroy a board. Null is ignored
+ */
+PERFT_API void perft_board_destroy( PerftBoard* board );
+
+/*
+ * Write the board's FEN string, null terminated, to a buffer. 100 characters is always enough
+ */
+PERFT_API PerftResult perft_board_get_fen( const PerftBoard* board, char* buffer, size_t size );
+
+/*
+ * Make a move, given in long algebraic notation, on the board
+ */
+PERFT_API PerftResult perft_board_make_move( PerftBoard* board, const char* move );
+
+/*
+ * Write the legal moves to a buffer. count receives the number of moves, even if the buffer is too small for
+ * them. 256 moves are always enough
+ */
+PERFT_API PerftResult perft_board_get_moves( const PerftBoard* board, PerftMove* moves, size_t capacity, size_t* count );
+
+/*
+ * Create a search with its options, or the defaults (one thread, no table) if options is null. The search is
+ * destroyed with perft_search_destroy
+ */
+PERFT_API PerftResult perft_search_create( const PerftOptions* options, PerftSearch** search );
+
+/*
+ * Destroy a search. Null is ignored
+ */
+PERFT_API void perft_search_destroy( PerftSearch* search );
+
+/*
+ * Count the leaf nodes to a depth from a board
+ */
+PERFT_API PerftResult perft_search_perft( PerftSearch* search, const PerftBoard* board, int depth, unsigned long long* nodes );
+
+/*
+ * Count the leaf nodes to a depth from a board, and below each root move. count receives the number of root
+ * moves, even if the buffer is too small for them, and nodes the total
+ */
+PERFT_API PerftResult perft_search_divide( PerftSearch* search, const PerftBoard* board, int depth, PerftDivide* entries, size_t capacity, size_t* count, unsigned long long* nodes );
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,233 @@
+#include "PerftCache.h"
+
+#include <cstring>
+#include <iostream>
+
+#include <windows.h>
+
+const char PerftCache::MAGIC[ 8 ] = { 'P', 'E', 'R', 'F', 'T', 'C', 'C', 'H' };
+
+const unsigned int PerftCache::VERSION = 2;
+const unsigned int PerftCache::DEFAULT_BUCKETS = 1 << 18;
+
+const unsigned long long PerftCache::MAX_NODES = 0x00FFFFFFFFFFFFFFull;
+
+PerftCache::PerftCache() :
+    file( INVALID_HANDLE_VALUE ),
+    mapping( nullptr ),
+    header( nullptr ),
+    buckets( nullptr ),
+    bucketMask( 0 ),
+    size( 0 ),
+    lookups( 0 ),
+    hits( 0 )
+{
+}
+
+PerftCache::~PerftCache()
+{
+    close();
+}
+
+bool PerftCache::open( const std::string& filename, unsigned int bucketCount )
+{
+    close();
+
+    if ( bucketCount == 0 || ( bucketCount & ( bucketCount - 1 ) ) != 0 )
+    {
+        std::cout << "Cache size must be a power of two: " << bucketCount << std::endl;
+        return false;
+    }
+
+    file = CreateFileA( filename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if ( file == INVALID_HANDLE_VALUE )
+    {
+        std::cout << "Cache file was not opened: " << filename << std::endl;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if ( !GetFileSizeEx( file, &fileSize ) )
+    {
+        fileSize.QuadPart = 0;
+    }
+
+    // Keep an existing file only if everything about it checks out
+    if ( fileSize.QuadPart >= static_cast<long long>( sizeof( Header ) ) && map( static_cast<size_t>( fileSize.QuadPart ) ) )
+    {
+        const char* problem = nullptr;
+
+        if ( memcmp( header->magic, MAGIC, sizeof( MAGIC ) ) != 0 )
+        {
+            problem = "not a cache file";
+        }
+        else if ( header->version != VERSION )
+        {
+            problem = "format version has changed";
+        }
+        else if ( header->bucketCount == 0 || ( header->bucketCount & ( header->bucketCount - 1 ) ) != 0 ||
+                  size != sizeof( Header ) + header->bucketCount * sizeof( Bucket ) )
+        {
+            problem = "file size is wrong";
+        }
+        else
+        {
+            bucketMask = header->bucketCount - 1;
+
+            if ( header->checksum != calculateChecksum() )
+            {
+                problem = "checksum failed";
+            }
+        }
+
+        if ( problem == nullptr )
+        {
+            return true;
+        }
+
+        std::cout << "Cache file discarded (" << problem << "): " << filename << std::endl;
+
+        unmap();
+    }
+
+    // Start again with an empty table - a new mapping is zero filled
+    CloseHandle( file );
+
+    file = CreateFileA( filename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr );
+    if ( file == INVALID_HANDLE_VALUE || !map( sizeof( Header ) + bucketCount * sizeof( Bucket ) ) )
+    {
+        std::cout << "Cache file was not created: " << filename << std::endl;
+        close();
+        return false;
+    }
+
+    memcpy( header->magic, MAGIC, sizeof( MAGIC ) );
+    header->version = VERSION;
+    header->bucketCount = bucketCount;
+    bucketMask = bucketCount - 1;
+
+    return true;
+}
+
+void PerftCache::close()
+{
+    if ( header != nullptr )
+    {
+        header->checksum = calculateChecksum();
+
+        FlushViewOfFile( header, size );
+        unmap();
+    }
+
+    if ( file != INVALID_HANDLE_VALUE )
+    {
+        CloseHandle( file );
+        file = INVALID_HANDLE_VALUE;
+    }
+}
+
+bool PerftCache::map( size_t size )
+{
+    mapping = CreateFileMappingA( file, nullptr, PAGE_READWRITE, static_cast<DWORD>( static_cast<unsigned long long>( size ) >> 32 ), static_cast<DWORD>( size ), nullptr );
+    if ( mapping == nullptr )
+    {
+        return false;
+    }
+
+    header = static_cast<Header*>( MapViewOfFile( mapping, FILE_MAP_ALL_ACCESS, 0, 0, size ) );
+    if ( header == nullptr )
+    {
+        CloseHandle( mapping );
+        mapping = nullptr;
+        return false;
+    }
+
+    // The view is page aligned and the header is one cache line, so the buckets are cache line aligned too
+    buckets = reinterpret_cast<Bucket*>( header + 1 );
+    this->size = size;
+
+    return true;
+}
+
+void PerftCache::unmap()
+{
+    UnmapViewOfFile( header );
+    CloseHandle( mapping );
+
+    mapping = nullptr;
+    header = nullptr;
+    buckets = nullptr;
+    bucketMask = 0;
+    size = 0;
+}
+
+unsigned long long PerftCache::calculateChecksum() const
+{
+    // FNV-1a over whole words rather than bytes - enough to catch a torn or truncated table
+    unsigned long long checksum = 0xCBF29CE484222325ull;
+
+    for ( unsigned long long bucket = 0; bucket <= bucketMask; bucket++ )
+    {
+        for ( int index = 0; index < BUCKET_ENTRIES; index++ )
+        {
+            const Entry& entry = buckets[ bucket ].entries[ index ];
+
+            checksum = ( checksum ^ entry.key ) * 0x100000001B3ull;
+            checksum = ( checksum ^ entry.data ) * 0x100000001B3ull;
+        }
+    }
+
+    return checksum;
+}
+
+bool PerftCache::find( unsigned long long key, int depth, unsigned long long& nodes )
+{
+    lookups++;
+
+    const Bucket& bucket = buckets[ key & bucketMask ];
+
+    for ( int index = 0; index < BUCKET_ENTRIES; index++ )
+    {
+        const Entry& entry = bucket.entries[ index ];
+
+        if ( entry.key == key && static_cast<int>( entry.data >> 56 ) == depth )
+        {
+            nodes = entry.data & MAX_NODES;
+            hits++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void PerftCache::store( unsigned long long key, int depth, unsigned long long nodes )
+{
+    if ( depth < 1 || depth > 255 || nodes > MAX_NODES )
+    {
+        return;
+    }
+
+    Bucket& bucket = buckets[ key & bucketMask ];
+
+    // Use the entry for this position and depth if there is one, otherwise the shallowest (empty entries have depth 0)
+    Entry* replace = &bucket.entries[ 0 ];
+    for ( int index = 0; index < BUCKET_ENTRIES; index++ )
+    {
+        Entry& entry = bucket.entries[ index ];
+
+        if ( entry.key == key && static_cast<int>( entry.data >> 56 ) == depth )
+        {
+            replace = &entry;
+            break;
+        }
+
+        if ( ( entry.data >> 56 ) < ( replace->data >> 56 ) )
+        {
+            replace = &entry;
+        }
+    }
+
+    replace->key = key;
+    replace->data = ( static_cast<unsigned long long>( depth ) << 56 ) | nodes;
+}
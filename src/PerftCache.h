@@ -0,0 +1,116 @@
+#pragma once
+
+#include <string>
+
+/// <summary>
+/// Leaf node counts for positions already searched, keyed by Zobrist key and depth and kept in a memory mapped
+/// file so that they survive from one run to the next.
+/// The file is a small header (format version, table size and a checksum of the table) followed by a hash table
+/// of cache line sized buckets. A file with the wrong version or a table that fails its checksum - e.g. because
+/// the process that wrote it never closed it - is thrown away and started again
+/// </summary>
+class PerftCache
+{
+private:
+    static const char MAGIC[ 8 ];
+
+    struct Header
+    {
+        char magic[ 8 ];
+        unsigned int version;
+        unsigned int bucketCount;
+        unsigned long long checksum;
+        unsigned char reserved[ 40 ];
+    };
+
+    // Depth in the top 8 bits of data and the node count in the rest. Depth 0 is never stored, so an all zero
+    // entry is empty
+    struct Entry
+    {
+        unsigned long long key;
+        unsigned long long data;
+    };
+
+    static const int BUCKET_ENTRIES = 4;
+
+    struct alignas( 64 ) Bucket
+    {
+        Entry entries[ BUCKET_ENTRIES ];
+    };
+
+    void* file;
+    void* mapping;
+    Header* header;
+    Bucket* buckets;
+    unsigned int bucketMask;
+    size_t size;
+
+    unsigned long long lookups;
+    unsigned long long hits;
+
+    bool map( size_t size );
+    void unmap();
+
+    unsigned long long calculateChecksum() const;
+
+public:
+    /// <summary>
+    /// Bump this whenever the file layout or the Zobrist keys change
+    /// </summary>
+    static const unsigned int VERSION;
+
+    /// <summary>
+    /// Table size for a new file - 2^18 buckets of four entries, 16MB
+    /// </summary>
+    static const unsigned int DEFAULT_BUCKETS;
+
+    static const unsigned long long MAX_NODES;
+
+    PerftCache();
+    ~PerftCache();
+
+    /// <summary>
+    /// Open or create a cache file
+    /// </summary>
+    /// <param name="filename">the cache file</param>
+    /// <param name="bucketCount">the table size if a new file has to be created - a power of two</param>
+    /// <returns><code>false</code> if the file can't be opened or mapped</returns>
+    bool open( const std::string& filename, unsigned int bucketCount = DEFAULT_BUCKETS );
+
+    /// <summary>
+    /// Write the checksum and flush the table to disk
+    /// </summary>
+    void close();
+
+    bool isOpen() const
+    {
+        return buckets != nullptr;
+    }
+
+    /// <summary>
+    /// Look up the count for a position searched to a depth
+    /// </summary>
+    /// <param name="key">the position's Zobrist key</param>
+    /// <param name="depth">the search depth</param>
+    /// <param name="nodes">receives the leaf node count if found</param>
+    /// <returns>true if found</returns>
+    bool find( unsigned long long key, int depth, unsigned long long& nodes );
+
+    /// <summary>
+    /// Store the count for a position searched to a depth, replacing the shallowest entry in the bucket if it is full
+    /// </summary>
+    /// <param name="key">the position's Zobrist key</param>
+    /// <param name="depth">the search depth, 1 to 255</param>
+    /// <param name="nodes">the leaf node count - ignored if over MAX_NODES</param>
+    void store( unsigned long long key, int depth, unsigned long long nodes );
+
+    unsigned long long getLookups() const
+    {
+        return lookups;
+    }
+
+    unsigned long long getHits() const
+    {
+        return hits;
+    }
+};
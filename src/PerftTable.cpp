@@ -0,0 +1,319 @@
+#include "PerftTable.h"
+
+#include <algorithm>
+#include <iostream>
+
+const size_t PerftTable::WRITE_BATCH = 4096;
+const size_t PerftTable::MAX_LOOKUPS = 65536;
+
+const unsigned long long PerftTable::MAX_NODES = 0x00FFFFFFFFFFFFFFull;
+
+PerftTable::PerftTable( size_t megabytes ) :
+    bucketMask( 0 ),
+    diskBucketMask( 0 ),
+    diskMinimumDepth( 256 ),
+    stopping( false ),
+    memoryHits( 0 ),
+    diskReads( 0 ),
+    diskHits( 0 ),
+    diskWrites( 0 )
+{
+    unsigned long long bucketCount = 1;
+    while ( ( bucketCount << 1 ) * sizeof( Bucket ) <= megabytes * 1024 * 1024 )
+    {
+        bucketCount <<= 1;
+    }
+
+    buckets.resize( bucketCount );
+    bucketMask = bucketCount - 1;
+}
+
+PerftTable::~PerftTable()
+{
+    if ( ioThread.joinable() )
+    {
+        queueWrites();
+
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            stopping = true;
+        }
+
+        requestsReady.notify_one();
+        ioThread.join();
+    }
+}
+
+bool PerftTable::openDiskTier( const std::string& filename, size_t gigabytes, int minimumDepth )
+{
+    unsigned long long bucketCount = 1;
+    while ( ( bucketCount << 1 ) * sizeof( Bucket ) <= static_cast<unsigned long long>( gigabytes ) * 1024 * 1024 * 1024 )
+    {
+        bucketCount <<= 1;
+    }
+
+    diskFile.open( filename, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc );
+
+    if ( !diskFile.is_open() )
+    {
+        std::cout << "Disk table was not created: " << filename << std::endl;
+        return false;
+    }
+
+    // Size the file by writing its last byte - everything before it reads back as zero, i.e. empty buckets
+    diskFile.seekp( bucketCount * sizeof( Bucket ) - 1 );
+    diskFile.put( 0 );
+    diskFile.flush();
+
+    if ( !diskFile )
+    {
+        std::cout << "Disk table could not be sized: " << filename << std::endl;
+        diskFile.close();
+        return false;
+    }
+
+    diskBucketMask = bucketCount - 1;
+    diskMinimumDepth = minimumDepth;
+
+    ioThread = std::thread( &PerftTable::ioLoop, this );
+
+    return true;
+}
+
+void PerftTable::prefetch( unsigned long long key, int depth )
+{
+    if ( depth < diskMinimumDepth )
+    {
+        return;
+    }
+
+    // No need to go to disk for what is already in memory
+    unsigned long long nodes;
+    if ( find( buckets[ key & bucketMask ], key, depth, nodes ) )
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+
+        // Drop results that were never collected because the position was found some other way first
+        if ( lookups.size() >= MAX_LOOKUPS )
+        {
+            for ( std::unordered_map<unsigned long long, Lookup>::iterator it = lookups.begin(); it != lookups.end(); )
+            {
+                it = it->second.complete ? lookups.erase( it ) : ++it;
+            }
+        }
+
+        std::pair<std::unordered_map<unsigned long long, Lookup>::iterator, bool> inserted =
+            lookups.emplace( lookupKey( key, depth ), Lookup { key, depth, false, false, 0 } );
+
+        if ( !inserted.second )
+        {
+            return;
+        }
+
+        readRequests.push_back( &inserted.first->second );
+    }
+
+    diskReads++;
+    requestsReady.notify_one();
+}
+
+bool PerftTable::find( unsigned long long key, int depth, unsigned long long& nodes )
+{
+    if ( find( buckets[ key & bucketMask ], key, depth, nodes ) )
+    {
+        memoryHits++;
+        return true;
+    }
+
+    if ( depth < diskMinimumDepth )
+    {
+        return false;
+    }
+
+    // Not in memory, so wait for the disk - normally the read was asked for when the parent was searched and is done
+    prefetch( key, depth );
+
+    std::unique_lock<std::mutex> lock( mutex );
+
+    std::unordered_map<unsigned long long, Lookup>::iterator it = lookups.find( lookupKey( key, depth ) );
+    if ( it == lookups.end() )
+    {
+        return false;
+    }
+
+    Lookup& lookup = it->second;
+    resultsReady.wait( lock, [ &lookup ]{ return lookup.complete; } );
+
+    const bool found = lookup.found && lookup.key == key && lookup.depth == depth;
+    nodes = lookup.nodes;
+
+    lookups.erase( it );
+    lock.unlock();
+
+    if ( found )
+    {
+        // Bring it back into memory for next time
+        store( buckets[ key & bucketMask ], key, depth, nodes );
+        diskHits++;
+    }
+
+    return found;
+}
+
+void PerftTable::store( unsigned long long key, int depth, unsigned long long nodes )
+{
+    if ( depth < 1 || depth > 255 || nodes > MAX_NODES )
+    {
+        return;
+    }
+
+    store( buckets[ key & bucketMask ], key, depth, nodes );
+
+    // Write through to disk
+    if ( depth >= diskMinimumDepth )
+    {
+        writeBuffer.push_back( Entry { key, ( static_cast<unsigned long long>( depth ) << 56 ) | nodes } );
+        diskWrites++;
+
+        if ( writeBuffer.size() >= WRITE_BATCH )
+        {
+            queueWrites();
+        }
+    }
+}
+
+bool PerftTable::find( const Bucket& bucket, unsigned long long key, int depth, unsigned long long& nodes )
+{
+    for ( int index = 0; index < BUCKET_ENTRIES; index++ )
+    {
+        const Entry& entry = bucket.entries[ index ];
+
+        if ( entry.key == key && static_cast<int>( entry.data >> 56 ) == depth )
+        {
+            nodes = entry.data & MAX_NODES;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void PerftTable::store( Bucket& bucket, unsigned long long key, int depth, unsigned long long nodes )
+{
+    // Use the entry for this position and depth if there is one, otherwise the shallowest (empty entries have depth 0)
+    Entry* replace = &bucket.entries[ 0 ];
+    for ( int index = 0; index < BUCKET_ENTRIES; index++ )
+    {
+        Entry& entry = bucket.entries[ index ];
+
+        if ( entry.key == key && static_cast<int>( entry.data >> 56 ) == depth )
+        {
+            replace = &entry;
+            break;
+        }
+
+        if ( ( entry.data >> 56 ) < ( replace->data >> 56 ) )
+        {
+            replace = &entry;
+        }
+    }
+
+    replace->key = key;
+    replace->data = ( static_cast<unsigned long long>( depth ) << 56 ) | nodes;
+}
+
+void PerftTable::queueWrites()
+{
+    if ( writeBuffer.empty() )
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        writeRequests.insert( writeRequests.end(), writeBuffer.begin(), writeBuffer.end() );
+    }
+
+    writeBuffer.clear();
+    requestsReady.notify_one();
+}
+
+void PerftTable::ioLoop()
+{
+    std::vector<Lookup*> reads;
+    std::vector<Entry> writes;
+    Bucket bucket;
+
+    std::unique_lock<std::mutex> lock( mutex );
+
+    while ( true )
+    {
+        requestsReady.wait( lock, [ this ]{ return stopping || !readRequests.empty() || !writeRequests.empty(); } );
+
+        if ( readRequests.empty() && writeRequests.empty() )
+        {
+            // Stopping, with nothing left to do
+            break;
+        }
+
+        reads.swap( readRequests );
+        writes.swap( writeRequests );
+
+        lock.unlock();
+
+        // Reads first as the search may be waiting on them. The Lookups stay put until they are marked complete
+        for ( std::vector<Lookup*>::const_iterator it = reads.cbegin(); it != reads.cend(); it++ )
+        {
+            Lookup& lookup = **it;
+
+            diskFile.seekg( ( lookup.key & diskBucketMask ) * sizeof( Bucket ) );
+            diskFile.read( reinterpret_cast<char*>( &bucket ), sizeof( Bucket ) );
+
+            unsigned long long nodes = 0;
+            const bool found = diskFile && find( bucket, lookup.key, lookup.depth, nodes );
+            diskFile.clear();
+
+            std::lock_guard<std::mutex> resultLock( mutex );
+            lookup.found = found;
+            lookup.nodes = nodes;
+            lookup.complete = true;
+        }
+
+        if ( !reads.empty() )
+        {
+            resultsReady.notify_all();
+            reads.clear();
+        }
+
+        // Writes in file order, so that a batch is one pass over the file rather than a random scatter, and each
+        // bucket is read and written once however many of the batch land in it
+        std::sort( writes.begin(), writes.end(), [ this ]( const Entry& a, const Entry& b ) { return ( a.key & diskBucketMask ) < ( b.key & diskBucketMask ); } );
+
+        for ( std::vector<Entry>::const_iterator it = writes.cbegin(); it != writes.cend(); )
+        {
+            const unsigned long long index = it->key & diskBucketMask;
+
+            diskFile.seekg( index * sizeof( Bucket ) );
+            diskFile.read( reinterpret_cast<char*>( &bucket ), sizeof( Bucket ) );
+            diskFile.clear();
+
+            for ( ; it != writes.cend() && ( it->key & diskBucketMask ) == index; it++ )
+            {
+                store( bucket, it->key, static_cast<int>( it->data >> 56 ), it->data & MAX_NODES );
+            }
+
+            diskFile.seekp( index * sizeof( Bucket ) );
+            diskFile.write( reinterpret_cast<const char*>( &bucket ), sizeof( Bucket ) );
+        }
+
+        writes.clear();
+
+        lock.lock();
+    }
+
+    diskFile.flush();
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// Transposition table for perft subtree counts, in two tiers.
+/// The memory tier is an ordinary bucketed hash table used at every depth. Counts at or above the disk depth are
+/// also written through to a much larger table in a file, so they survive being evicted from memory.
+/// The file is only touched by a background I/O thread - writes are queued and written in batches in file order,
+/// and reads are requested ahead of time (see prefetch) so that the search rarely waits on the disk
+/// </summary>
+class PerftTable
+{
+private:
+    // Depth in the top 8 bits of data and the node count in the rest, as in the perft cache
+    struct Entry
+    {
+        unsigned long long key;
+        unsigned long long data;
+    };
+
+    static const int BUCKET_ENTRIES = 4;
+
+    struct alignas( 64 ) Bucket
+    {
+        Entry entries[ BUCKET_ENTRIES ];
+    };
+
+    /// <summary>
+    /// A disk read that has been asked for, and its result once the I/O thread has it
+    /// </summary>
+    struct Lookup
+    {
+        unsigned long long key;
+        int depth;
+        bool complete;
+        bool found;
+        unsigned long long nodes;
+    };
+
+    static const size_t WRITE_BATCH;
+    static const size_t MAX_LOOKUPS;
+
+    // Memory tier
+    std::vector<Bucket> buckets;
+    unsigned long long bucketMask;
+
+    // Disk tier
+    std::fstream diskFile;
+    unsigned long long diskBucketMask;
+    int diskMinimumDepth;
+
+    std::thread ioThread;
+    std::mutex mutex;
+    std::condition_variable requestsReady;
+    std::condition_variable resultsReady;
+    bool stopping;
+
+    // Shared with the I/O thread - only touched with the mutex held
+    std::vector<Lookup*> readRequests;
+    std::vector<Entry> writeRequests;
+    std::unordered_map<unsigned long long, Lookup> lookups;
+
+    // Only touched by the search thread
+    std::vector<Entry> writeBuffer;
+
+    unsigned long long memoryHits;
+    unsigned long long diskReads;
+    unsigned long long diskHits;
+    unsigned long long diskWrites;
+
+    static unsigned long long lookupKey( unsigned long long key, int depth )
+    {
+        return key ^ ( static_cast<unsigned long long>( depth ) << 56 );
+    }
+
+    static bool find( const Bucket& bucket, unsigned long long key, int depth, unsigned long long& nodes );
+    static void store( Bucket& bucket, unsigned long long key, int depth, unsigned long long nodes );
+
+    void queueWrites();
+    void ioLoop();
+
+public:
+    static const unsigned long long MAX_NODES;
+
+    /// <summary>
+    /// Create the memory tier
+    /// </summary>
+    /// <param name="megabytes">memory to use, rounded down to a power of two number of buckets</param>
+    PerftTable( size_t megabytes );
+
+    /// <summary>
+    /// Flushes any outstanding writes and stops the I/O thread
+    /// </summary>
+    ~PerftTable();
+
+    /// <summary>
+    /// Add the disk tier. The file is created afresh
+    /// </summary>
+    /// <param name="filename">the table file</param>
+    /// <param name="gigabytes">file size, rounded down to a power of two number of buckets</param>
+    /// <param name="minimumDepth">the smallest depth written to disk - the deeper, the fewer and more valuable the entries</param>
+    /// <returns><code>false</code> if the file can't be created</returns>
+    bool openDiskTier( const std::string& filename, size_t gigabytes, int minimumDepth );
+
+    /// <summary>
+    /// The smallest depth that is kept on disk, or a depth that will never be reached if there is no disk tier
+    /// </summary>
+    int getDiskMinimumDepth() const
+    {
+        return diskMinimumDepth;
+    }
+
+    /// <summary>
+    /// Ask for the disk tier to be read for a position that will be looked up soon
+    /// </summary>
+    /// <param name="key">the position's Zobrist key</param>
+    /// <param name="depth">the search depth</param>
+    void prefetch( unsigned long long key, int depth );
+
+    /// <summary>
+    /// Look up the count for a position searched to a depth, waiting for the disk tier if it has to
+    /// </summary>
+    /// <param name="key">the position's Zobrist key</param>
+    /// <param name="depth">the search depth</param>
+    /// <param name="nodes">receives the leaf node count if found</param>
+    /// <returns>true if found</returns>
+    bool find( unsigned long long key, int depth, unsigned long long& nodes );
+
+    /// <summary>
+    /// Store the count for a position searched to a depth
+    /// </summary>
+    /// <param name="key">the position's Zobrist key</param>
+    /// <param name="depth">the search depth, 1 to 255</param>
+    /// <param name="nodes">the leaf node count - ignored if over MAX_NODES</param>
+    void store( unsigned long long key, int depth, unsigned long long nodes );
+
+    unsigned long long getMemoryHits() const
+    {
+        return memoryHits;
+    }
+
+    unsigned long long getDiskReads() const
+    {
+        return diskReads;
+    }
+
+    unsigned long long getDiskHits() const
+    {
+        return diskHits;
+    }
+
+    unsigned long long getDiskWrites() const
+    {
+        return diskWrites;
+    }
+};
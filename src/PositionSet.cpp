@@ -0,0 +1,272 @@
+#include "PositionSet.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <queue>
+
+const int PositionSet::SHARD_BITS = 6;
+const size_t PositionSet::SHARDS = 1 << PositionSet::SHARD_BITS;
+const size_t PositionSet::INITIAL_SLOTS = 1024;
+const size_t PositionSet::READ_BUFFER = 4096;
+
+PositionSet::PositionSet( int plies, size_t megabytes, const std::string& spillFilename ) :
+    shards( plies * SHARDS ),
+    memoryInUse( 0 ),
+    memoryLimit( megabytes * 1024 * 1024 ),
+    spillFailed( false ),
+    spillFilename( spillFilename ),
+    spillSize( 0 ),
+    spilledKeys( 0 )
+{
+    for ( std::vector<Shard>::iterator it = shards.begin(); it != shards.end(); it++ )
+    {
+        it->slots.assign( INITIAL_SLOTS, 0 );
+        it->used = 0;
+    }
+
+    memoryInUse = shards.size() * INITIAL_SLOTS * sizeof( unsigned long long );
+}
+
+PositionSet::~PositionSet()
+{
+    if ( spillFile.is_open() )
+    {
+        spillFile.close();
+        std::remove( spillFilename.c_str() );
+    }
+}
+
+bool PositionSet::insert( int ply, unsigned long long key )
+{
+    // Zero marks an empty slot, so a position with that key shares 1 with any other - one more collision in 2^64
+    if ( key == 0 )
+    {
+        key = 1;
+    }
+
+    const size_t shardIndex = getShardIndex( ply, key );
+    Shard& shard = shards[ shardIndex ];
+
+    std::lock_guard<std::mutex> lock( shard.mutex );
+
+    // The top bits choose the shard, so the slot comes from the bottom bits
+    const size_t mask = shard.slots.size() - 1;
+    for ( size_t index = key & mask; shard.slots[ index ] != 0; index = ( index + 1 ) & mask )
+    {
+        if ( shard.slots[ index ] == key )
+        {
+            return false;
+        }
+    }
+
+    insertSlot( shard.slots, key );
+    shard.used++;
+
+    // Keep the table no more than half full so that probes stay short
+    if ( shard.used * 2 >= shard.slots.size() )
+    {
+        makeRoom( shard, shardIndex );
+    }
+
+    return true;
+}
+
+void PositionSet::insertSlot( std::vector<unsigned long long>& slots, unsigned long long key )
+{
+    const size_t mask = slots.size() - 1;
+
+    size_t index = key & mask;
+    while ( slots[ index ] != 0 )
+    {
+        index = ( index + 1 ) & mask;
+    }
+
+    slots[ index ] = key;
+}
+
+void PositionSet::makeRoom( Shard& shard, size_t shardIndex )
+{
+    const size_t growth = shard.slots.size() * sizeof( unsigned long long );
+
+    if ( spillFailed || memoryInUse.fetch_add( growth ) + growth <= memoryLimit )
+    {
+        std::vector<unsigned long long> slots( shard.slots.size() * 2, 0 );
+
+        for ( std::vector<unsigned long long>::const_iterator it = shard.slots.cbegin(); it != shard.slots.cend(); it++ )
+        {
+            if ( *it != 0 )
+            {
+                insertSlot( slots, *it );
+            }
+        }
+
+        shard.slots.swap( slots );
+
+        return;
+    }
+
+    memoryInUse -= growth;
+
+    // Without anywhere to spill to, going over the limit is better than failing
+    if ( !spill( shard, shardIndex ) )
+    {
+        spillFailed = true;
+        memoryInUse += growth;
+
+        makeRoom( shard, shardIndex );
+    }
+}
+
+size_t PositionSet::sortKeys( Shard& shard )
+{
+    std::vector<unsigned long long>::iterator end =
+        std::remove( shard.slots.begin(), shard.slots.end(), 0ull );
+
+    std::sort( shard.slots.begin(), end );
+
+    return end - shard.slots.begin();
+}
+
+bool PositionSet::spill( Shard& shard, size_t shardIndex )
+{
+    std::lock_guard<std::mutex> lock( spillMutex );
+
+    if ( !spillFile.is_open() )
+    {
+        spillFile.open( spillFilename, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc );
+
+        if ( !spillFile.is_open() )
+        {
+            std::cout << "Spill file was not created, so memory will go over the limit: " << spillFilename << std::endl;
+            return false;
+        }
+    }
+
+    // Sort in place, write the run, and empty the shard without giving back its memory
+    const size_t count = sortKeys( shard );
+
+    spillFile.seekp( spillSize );
+    spillFile.write( reinterpret_cast<const char*>( shard.slots.data() ), count * sizeof( unsigned long long ) );
+
+    if ( !spillFile )
+    {
+        std::cout << "Spill file could not be written, so memory will go over the limit: " << spillFilename << std::endl;
+        spillFile.clear();
+        return false;
+    }
+
+    runs.push_back( Run { shardIndex, spillSize, count } );
+    spillSize += count * sizeof( unsigned long long );
+    spilledKeys += count;
+
+    std::fill( shard.slots.begin(), shard.slots.end(), 0 );
+    shard.used = 0;
+
+    return true;
+}
+
+bool PositionSet::refill( RunReader& reader )
+{
+    if ( reader.remaining == 0 )
+    {
+        return false;
+    }
+
+    const size_t count = static_cast<size_t>( std::min<unsigned long long>( reader.remaining, READ_BUFFER ) );
+
+    reader.buffer.resize( count );
+    spillFile.seekg( reader.offset );
+    spillFile.read( reinterpret_cast<char*>( reader.buffer.data() ), count * sizeof( unsigned long long ) );
+
+    reader.offset += count * sizeof( unsigned long long );
+    reader.remaining -= count;
+    reader.position = 0;
+
+    return true;
+}
+
+unsigned long long PositionSet::count( int ply )
+{
+    unsigned long long distinct = 0;
+
+    for ( size_t shardIndex = ( ply - 1 ) * SHARDS; shardIndex < ply * SHARDS; shardIndex++ )
+    {
+        Shard& shard = shards[ shardIndex ];
+
+        std::vector<RunReader> readers;
+        for ( std::vector<Run>::const_iterator it = runs.cbegin(); it != runs.cend(); it++ )
+        {
+            if ( it->shardIndex == shardIndex )
+            {
+                readers.push_back( RunReader { it->offset, it->count, std::vector<unsigned long long>(), 0 } );
+            }
+        }
+
+        // Nothing spilled, so every key in memory is distinct
+        if ( readers.empty() )
+        {
+            distinct += shard.used;
+            continue;
+        }
+
+        // Merge the runs and the keys still in memory, smallest first, counting each key once.
+        // The merge queue holds the next key from each source - the keys in memory are the source after the runs
+        const size_t memoryCount = sortKeys( shard );
+        size_t memoryPosition = 0;
+
+        typedef std::pair<unsigned long long, size_t> Next;
+        std::priority_queue<Next, std::vector<Next>, std::greater<Next>> queue;
+
+        for ( size_t source = 0; source < readers.size(); source++ )
+        {
+            if ( refill( readers[ source ] ) )
+            {
+                queue.push( Next( readers[ source ].buffer[ 0 ], source ) );
+            }
+        }
+
+        if ( memoryCount > 0 )
+        {
+            queue.push( Next( shard.slots[ 0 ], readers.size() ) );
+        }
+
+        bool first = true;
+        unsigned long long previous = 0;
+
+        while ( !queue.empty() )
+        {
+            const Next next = queue.top();
+            queue.pop();
+
+            if ( first || next.first != previous )
+            {
+                distinct++;
+                previous = next.first;
+                first = false;
+            }
+
+            if ( next.second == readers.size() )
+            {
+                if ( ++memoryPosition < memoryCount )
+                {
+                    queue.push( Next( shard.slots[ memoryPosition ], next.second ) );
+                }
+            }
+            else
+            {
+                RunReader& reader = readers[ next.second ];
+
+                if ( ++reader.position < reader.buffer.size() || refill( reader ) )
+                {
+                    queue.push( Next( reader.buffer[ reader.position ], next.second ) );
+                }
+            }
+        }
+
+        shard.used = 0;
+    }
+
+    return distinct;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// The set of distinct positions, by Zobrist key, seen at each ply of a search.
+/// Each ply's keys are split into shards by their top bits, each an open addressing hash table with its own lock,
+/// so that several threads can insert at once. When a shard is full and growing it would go over the memory limit,
+/// its keys are sorted and written to the spill file as a run and the shard starts again empty. Counting merges a
+/// shard's runs with what is still in memory, so a key that was spilled and seen again is only counted once
+/// </summary>
+class PositionSet
+{
+private:
+    static const int SHARD_BITS;
+    static const size_t SHARDS;
+    static const size_t INITIAL_SLOTS;
+    static const size_t READ_BUFFER;
+
+    // A key of zero marks an empty slot
+    struct Shard
+    {
+        std::mutex mutex;
+        std::vector<unsigned long long> slots;
+        size_t used;
+    };
+
+    /// <summary>
+    /// Sorted keys written to the spill file for one shard
+    /// </summary>
+    struct Run
+    {
+        size_t shardIndex;
+        unsigned long long offset;
+        unsigned long long count;
+    };
+
+    /// <summary>
+    /// Reads a run back a buffer at a time while merging
+    /// </summary>
+    struct RunReader
+    {
+        unsigned long long offset;
+        unsigned long long remaining;
+        std::vector<unsigned long long> buffer;
+        size_t position;
+    };
+
+    std::vector<Shard> shards;
+
+    std::atomic<size_t> memoryInUse;
+    size_t memoryLimit;
+    std::atomic<bool> spillFailed;
+
+    // Only touched with the spill mutex held
+    std::mutex spillMutex;
+    std::string spillFilename;
+    std::fstream spillFile;
+    unsigned long long spillSize;
+    std::vector<Run> runs;
+
+    unsigned long long spilledKeys;
+
+    size_t getShardIndex( int ply, unsigned long long key ) const
+    {
+        return ( ply - 1 ) * SHARDS + static_cast<size_t>( key >> ( 64 - SHARD_BITS ) );
+    }
+
+    /// <summary>
+    /// Move a shard's keys to the front of its slots and sort them
+    /// </summary>
+    /// <returns>the number of keys</returns>
+    static size_t sortKeys( Shard& shard );
+
+    static void insertSlot( std::vector<unsigned long long>& slots, unsigned long long key );
+
+    /// <summary>
+    /// Make room in a full shard - grow it if the memory limit allows, otherwise spill it. Called with the shard locked
+    /// </summary>
+    void makeRoom( Shard& shard, size_t shardIndex );
+
+    bool spill( Shard& shard, size_t shardIndex );
+
+    bool refill( RunReader& reader );
+
+public:
+    /// <summary>
+    /// Create an empty set for plies 1 to plies
+    /// </summary>
+    /// <param name="plies">the deepest ply</param>
+    /// <param name="megabytes">memory to use for keys before spilling to disk</param>
+    /// <param name="spillFilename">the file for spilled keys, only created if it is needed</param>
+    PositionSet( int plies, size_t megabytes, const std::string& spillFilename );
+
+    /// <summary>
+    /// Deletes the spill file
+    /// </summary>
+    ~PositionSet();
+
+    /// <summary>
+    /// Add a position. Safe to call from several threads at once
+    /// </summary>
+    /// <param name="ply">the ply the position was reached at, 1 to plies</param>
+    /// <param name="key">the position's Zobrist key</param>
+    /// <returns>true if the key was not already in memory - a key that has been spilled is added again and only
+    /// removed as a duplicate when counting</returns>
+    bool insert( int ply, unsigned long long key );
+
+    /// <summary>
+    /// Count the distinct positions at a ply. Once a ply has been counted, nothing more can be inserted at that ply
+    /// </summary>
+    /// <param name="ply">the ply, 1 to plies</param>
+    /// <returns>the number of distinct keys</returns>
+    unsigned long long count( int ply );
+
+    size_t getSpilledRuns() const
+    {
+        return runs.size();
+    }
+
+    unsigned long long getSpilledKeys() const
+    {
+        return spilledKeys;
+    }
+};
@@ -0,0 +1,389 @@
+#include "Server.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iostream>
+
+#include "Fen.h"
+#include "Test.h"
+
+Server::Server() :
+    board( Board::createBoard( Fen::startingPosition ) ),
+    jobNumber( 0 ),
+    jobWorkers( 0 ),
+    busyWorkers( 0 ),
+    quitting( false ),
+    jobDepth( 0 ),
+    nextMove( 0 ),
+    stopping( false )
+{
+    // The table and cache aren't safe to share between threads, so with either from the command line one worker does
+    // it all
+    startWorkers( Test::table != nullptr || Test::cache != nullptr ? 1 : std::max( 1u, std::thread::hardware_concurrency() ) );
+
+    Test::stopSignal = &stopping;
+}
+
+Server::~Server()
+{
+    stopping = true;
+    waitForSearch();
+    stopWorkers();
+
+    Test::stopSignal = nullptr;
+
+    if ( table )
+    {
+        Test::setTable( nullptr );
+    }
+}
+
+void Server::respond( const std::string& line )
+{
+    std::lock_guard<std::mutex> lock( outputMutex );
+
+    std::cout << line << std::endl;
+}
+
+void Server::startWorkers( unsigned int count )
+{
+    // New workers wait for the next job, not one that has already been run
+    unsigned long long lastJob;
+
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        quitting = false;
+        lastJob = jobNumber;
+    }
+
+    for ( unsigned int index = 0; index < count; index++ )
+    {
+        workers.emplace_back( &Server::workerLoop, this, index, lastJob );
+    }
+}
+
+void Server::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex );
+        quitting = true;
+    }
+
+    jobReady.notify_all();
+
+    for ( std::vector<std::thread>::iterator it = workers.begin(); it != workers.end(); it++ )
+    {
+        it->join();
+    }
+
+    workers.clear();
+}
+
+void Server::workerLoop( unsigned int index, unsigned long long lastJob )
+{
+    while ( true )
+    {
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+            jobReady.wait( lock, [ & ] { return quitting || jobNumber != lastJob; } );
+
+            if ( quitting )
+            {
+                return;
+            }
+
+            lastJob = jobNumber;
+
+            if ( index >= jobWorkers )
+            {
+                continue;
+            }
+        }
+
+        // Each worker searches its root moves on its own copy of the job's position
+        Board position = *jobBoard;
+
+        for ( size_t move = nextMove++; move < jobMoves.size() && !stopping; move = nextMove++ )
+        {
+            Board::State undo = position.makeMove( jobMoves[ move ] );
+            jobCounts[ move ] = Test::perftLoop( jobDepth - 1, &position );
+            position.unmakeMove( undo );
+
+            // A search that was stopped part way through returns a partial count
+            jobFinished[ move ] = !stopping;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            busyWorkers--;
+        }
+
+        jobDone.notify_all();
+    }
+}
+
+void Server::waitForSearch()
+{
+    if ( searchThread.joinable() )
+    {
+        searchThread.join();
+    }
+}
+
+void Server::search( int depth, bool divide )
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    unsigned long long nodes = 0;
+    bool stopped = false;
+
+    if ( depth == 0 )
+    {
+        nodes = 1;
+    }
+    else
+    {
+        // The workers copy the position from the job, as a position command can replace the board once the search is done
+        jobBoard.reset( new Board( *board ) );
+
+        jobMoves.clear();
+        jobBoard->getMoves( jobMoves );
+
+        jobDepth = depth;
+        Test::setCacheMinimumDepth( depth );
+
+        jobCounts.assign( jobMoves.size(), 0 );
+        jobFinished.assign( jobMoves.size(), 0 );
+        nextMove = 0;
+
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+
+            jobWorkers = static_cast<unsigned int>( workers.size() );
+            busyWorkers = jobWorkers;
+            jobNumber++;
+
+            jobReady.notify_all();
+            jobDone.wait( lock, [ & ] { return busyWorkers == 0; } );
+        }
+
+        for ( size_t move = 0; move < jobMoves.size(); move++ )
+        {
+            if ( !jobFinished[ move ] )
+            {
+                stopped = true;
+                continue;
+            }
+
+            nodes += jobCounts[ move ];
+
+            if ( divide )
+            {
+                respond( jobMoves[ move ].toString() + ": " + std::to_string( jobCounts[ move ] ) );
+            }
+        }
+    }
+
+    const std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+
+    std::string result = "nodes " + std::to_string( nodes ) + " time " + std::to_string( std::chrono::duration_cast<std::chrono::milliseconds>( elapsed ).count() );
+    if ( stopped )
+    {
+        result += " stopped";
+    }
+
+    respond( result );
+}
+
+void Server::setPosition( std::istringstream& command )
+{
+    std::string token;
+    command >> token;
+
+    std::string fen;
+
+    if ( token == "startpos" )
+    {
+        fen = Fen::startingPosition;
+        command >> token;
+    }
+    else if ( token == "fen" )
+    {
+        while ( command >> token && token != "moves" )
+        {
+            fen += fen.empty() ? token : " " + token;
+        }
+    }
+
+    if ( fen.empty() )
+    {
+        respond( "error position needs startpos or fen [fen]" );
+        return;
+    }
+
+    if ( !Fen::isValid( fen ) )
+    {
+        respond( "error invalid fen " + fen );
+        return;
+    }
+
+    std::unique_ptr<Board> position( Board::createBoard( fen ) );
+
+    if ( token == "moves" )
+    {
+        std::vector<Move> moves;
+
+        while ( command >> token )
+        {
+            moves.clear();
+            position->getMoves( moves );
+
+            std::vector<Move>::const_iterator it = moves.cbegin();
+            while ( it != moves.cend() && it->toString() != token )
+            {
+                it++;
+            }
+
+            if ( it == moves.cend() )
+            {
+                respond( "error illegal move " + token + " in " + position->toString() );
+                return;
+            }
+
+            position->makeMove( *it );
+        }
+    }
+
+    board = std::move( position );
+}
+
+void Server::setOption( std::istringstream& command )
+{
+    std::string name;
+    std::string value;
+
+    command >> name;
+    if ( name == "name" )
+    {
+        command >> name >> value;
+        if ( value == "value" )
+        {
+            command >> value;
+        }
+    }
+    else
+    {
+        command >> value;
+    }
+
+    std::transform( name.begin(), name.end(), name.begin(), ::tolower );
+
+    const int number = atoi( value.c_str() );
+
+    if ( value.empty() || value.find_first_not_of( "0123456789" ) != std::string::npos )
+    {
+        respond( "error setoption " + name + " needs a number" );
+    }
+    else if ( name == "hash" && number > 0 && workers.size() > 1 )
+    {
+        respond( "error setoption hash needs threads 1, as the table can't be shared between threads" );
+    }
+    else if ( name == "hash" )
+    {
+        Test::setTable( nullptr );
+        table.reset();
+
+        if ( number > 0 )
+        {
+            table.reset( new PerftTable( number ) );
+            Test::setTable( table.get() );
+        }
+    }
+    else if ( name == "threads" && number == 0 )
+    {
+        respond( "error setoption threads needs at least 1" );
+    }
+    else if ( name == "threads" && number > 1 && ( Test::table != nullptr || Test::cache != nullptr ) )
+    {
+        respond( "error setoption threads needs hash 0 and no cache, as they can't be shared between threads" );
+    }
+    else if ( name == "threads" )
+    {
+        stopWorkers();
+        startWorkers( number );
+    }
+    else
+    {
+        respond( "error unknown option " + name );
+    }
+}
+
+void Server::run()
+{
+    std::string line;
+    while ( std::getline( std::cin, line ) )
+    {
+        std::istringstream command( line );
+
+        std::string word;
+        if ( !( command >> word ) )
+        {
+            continue;
+        }
+
+        // Answered whether or not a search is running
+        if ( word == "stop" )
+        {
+            stopping = true;
+            continue;
+        }
+        else if ( word == "isready" )
+        {
+            respond( "readyok" );
+            continue;
+        }
+        else if ( word == "quit" )
+        {
+            break;
+        }
+
+        waitForSearch();
+        stopping = false;
+
+        if ( word == "position" )
+        {
+            setPosition( command );
+        }
+        else if ( word == "setoption" )
+        {
+            setOption( command );
+        }
+        else if ( word == "go" || word == "divide" )
+        {
+            std::string depth;
+            command >> depth;
+
+            if ( word == "go" && depth == "perft" )
+            {
+                command >> depth;
+            }
+
+            if ( depth.empty() || depth.find_first_not_of( "0123456789" ) != std::string::npos )
+            {
+                respond( "error " + word + " needs a depth" );
+            }
+            else
+            {
+                searchThread = std::thread( &Server::search, this, atoi( depth.c_str() ), word == "divide" );
+            }
+        }
+        else
+        {
+            respond( "error unknown command " + word );
+        }
+    }
+
+    stopping = true;
+    waitForSearch();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Board.h"
+#include "PerftTable.h"
+
+/// <summary>
+/// A long running perft process that takes line commands on stdin and answers on stdout, so that a tool making
+/// many small queries pays for start up once and keeps the table and threads warm between them.
+/// Commands:
+///   position startpos|fen [fen] [moves [move] ...]  - set the root position
+///   go perft [depth]                               - count the nodes, answering "nodes [count] time [ms]"
+///   divide [depth]                                 - count the nodes below each root move, one "[move]: [count]" line each, then "nodes ..."
+///   setoption hash [megabytes] / threads [count]   - also accepts the "setoption name ... value ..." form
+///   stop                                           - stop the search in progress, answering for the root moves finished
+///   isready                                        - answers "readyok" straight away, even during a search
+///   quit                                           - stop and exit, as does the end of the input
+/// A search runs in the background while commands are still read - anything but stop, isready and quit waits for it
+/// to finish first. Errors are answered with a line starting "error".
+/// The table and cache aren't safe to share between threads, so while either is in use there is one thread - it
+/// starts with one if the command line gives either, and a setoption that would mix them with more is refused
+/// </summary>
+class Server
+{
+private:
+    std::unique_ptr<Board> board;
+    std::unique_ptr<PerftTable> table;
+
+    // The pool - a job is the root moves of one search, shared out between the workers taking part
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable jobReady;
+    std::condition_variable jobDone;
+    unsigned long long jobNumber;
+    unsigned int jobWorkers;
+    unsigned int busyWorkers;
+    bool quitting;
+
+    // The job in progress, from a copy of the current position
+    std::unique_ptr<Board> jobBoard;
+    int jobDepth;
+    std::vector<Move> jobMoves;
+    std::vector<unsigned long long> jobCounts;
+    std::vector<char> jobFinished;
+    std::atomic<size_t> nextMove;
+    std::atomic<bool> stopping;
+
+    // Runs each search and answers for it, so that commands can still be read meanwhile
+    std::thread searchThread;
+
+    std::mutex outputMutex;
+
+    void respond( const std::string& line );
+
+    void startWorkers( unsigned int count );
+    void stopWorkers();
+    void workerLoop( unsigned int index, unsigned long long lastJob );
+
+    void waitForSearch();
+    void search( int depth, bool divide );
+
+    void setPosition( std::istringstream& command );
+    void setOption( std::istringstream& command );
+
+public:
+    Server();
+
+    /// <summary>
+    /// Stops any search and the workers
+    /// </summary>
+    ~Server();
+
+    /// <summary>
+    /// Read and answer commands until quit or the end of the input
+    /// </summary>
+    void run();
+};
@@ -0,0 +1,172 @@
+#include "SharedTable.h"
+
+#include <cstring>
+#include <iostream>
+
+#include <windows.h>
+
+const char SharedTable::MAGIC[ 8 ] = { 'P', 'E', 'R', 'F', 'T', 'S', 'H', 'M' };
+
+const unsigned int SharedTable::VERSION = 1;
+
+const unsigned long long SharedTable::MAX_NODES = 0x00FFFFFFFFFFFFFFull;
+
+SharedTable::SharedTable() :
+    mapping( nullptr ),
+    header( nullptr ),
+    buckets( nullptr ),
+    bucketMask( 0 ),
+    created( false ),
+    hits( 0 )
+{
+}
+
+SharedTable::~SharedTable()
+{
+    close();
+}
+
+bool SharedTable::open( const std::string& name, size_t megabytes )
+{
+    close();
+
+    unsigned long long bucketCount = 1;
+    while ( ( bucketCount << 1 ) * sizeof( Bucket ) <= megabytes * 1024 * 1024 )
+    {
+        bucketCount <<= 1;
+    }
+
+    const unsigned long long size = sizeof( Header ) + bucketCount * sizeof( Bucket );
+
+    // Backed by the page file rather than a file of our own, and zero filled when created
+    const std::string objectName = "Local\\perft." + name;
+
+    mapping = CreateFileMappingA( INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>( size >> 32 ), static_cast<DWORD>( size ), objectName.c_str() );
+    if ( mapping == nullptr )
+    {
+        std::cout << "Shared table was not created: " << name << std::endl;
+        return false;
+    }
+
+    created = GetLastError() != ERROR_ALREADY_EXISTS;
+
+    // The whole section, however big its creator made it
+    header = static_cast<Header*>( MapViewOfFile( mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0 ) );
+    if ( header == nullptr )
+    {
+        std::cout << "Shared table was not mapped: " << name << std::endl;
+        close();
+        return false;
+    }
+
+    if ( created )
+    {
+        memcpy( header->magic, MAGIC, sizeof( MAGIC ) );
+        header->version = VERSION;
+        header->bucketCount = bucketCount;
+
+        header->ready.store( 1, std::memory_order_release );
+    }
+    else
+    {
+        // The creator may still be filling in the header
+        for ( int wait = 0; wait < 5000 && header->ready.load( std::memory_order_acquire ) == 0; wait++ )
+        {
+            Sleep( 1 );
+        }
+
+        if ( header->ready.load( std::memory_order_acquire ) == 0 || memcmp( header->magic, MAGIC, sizeof( MAGIC ) ) != 0 || header->version != VERSION )
+        {
+            std::cout << "Shared table is not a perft table of this version: " << name << std::endl;
+            close();
+            return false;
+        }
+    }
+
+    // The view is page aligned and the header is one cache line, so the buckets are cache line aligned too
+    buckets = reinterpret_cast<Bucket*>( header + 1 );
+    bucketMask = header->bucketCount - 1;
+
+    return true;
+}
+
+void SharedTable::close()
+{
+    if ( header != nullptr )
+    {
+        UnmapViewOfFile( header );
+    }
+
+    if ( mapping != nullptr )
+    {
+        CloseHandle( mapping );
+    }
+
+    mapping = nullptr;
+    header = nullptr;
+    buckets = nullptr;
+    bucketMask = 0;
+    created = false;
+}
+
+bool SharedTable::find( unsigned long long key, int depth, unsigned long long& nodes )
+{
+    Bucket& bucket = buckets[ key & bucketMask ];
+
+    for ( int index = 0; index < BUCKET_ENTRIES; index++ )
+    {
+        const Entry& entry = bucket.entries[ index ];
+
+        const unsigned long long data = entry.data.load( std::memory_order_relaxed );
+
+        if ( ( entry.check.load( std::memory_order_relaxed ) ^ data ) == key && static_cast<int>( data >> 56 ) == depth )
+        {
+            nodes = data & MAX_NODES;
+            hits.fetch_add( 1, std::memory_order_relaxed );
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void SharedTable::store( unsigned long long key, int depth, unsigned long long nodes )
+{
+    // Depth 0 marks an empty entry and only 8 bits are kept, so anything outside 1 to 255 can't be stored faithfully
+    if ( depth < 1 || depth > 255 || nodes > MAX_NODES )
+    {
+        return;
+    }
+
+    Bucket& bucket = buckets[ key & bucketMask ];
+
+    // Use the entry for this position and depth if there is one, otherwise the shallowest (empty entries have depth 0)
+    Entry* replace = &bucket.entries[ 0 ];
+    unsigned long long replaceDepth = replace->data.load( std::memory_order_relaxed ) >> 56;
+
+    for ( int index = 0; index < BUCKET_ENTRIES; index++ )
+    {
+        Entry& entry = bucket.entries[ index ];
+
+        const unsigned long long data = entry.data.load( std::memory_order_relaxed );
+
+        if ( ( entry.check.load( std::memory_order_relaxed ) ^ data ) == key && static_cast<int>( data >> 56 ) == depth )
+        {
+            replace = &entry;
+            break;
+        }
+
+        if ( ( data >> 56 ) < replaceDepth )
+        {
+            replace = &entry;
+            replaceDepth = data >> 56;
+        }
+    }
+
+    // Another process writing the same entry at the same time can leave it torn, which find sees as a miss
+    const unsigned long long data = ( static_cast<unsigned long long>( depth ) << 56 ) | nodes;
+
+    replace->data.store( data, std::memory_order_relaxed );
+    replace->check.store( key ^ data, std::memory_order_relaxed );
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+/// <summary>
+/// Transposition table for perft subtree counts in named shared memory, so that perft processes running on the
+/// same machine at the same time share each other's results.
+/// The first process to open a name creates the table and the others attach to it, whatever size they asked for.
+/// The memory is backed by the page file and goes away when the last process using it closes it, so there is
+/// nothing to clean up after a crash.
+/// Entries are lockless - each keeps its key XORed with its data, so an entry torn by two processes writing it at
+/// once no longer matches its key and is just a miss
+/// </summary>
+class SharedTable
+{
+private:
+    static const char MAGIC[ 8 ];
+
+    // Bump this whenever the layout or the Zobrist keys change
+    static const unsigned int VERSION;
+
+    struct Header
+    {
+        char magic[ 8 ];
+        unsigned int version;
+
+        // Set by the creator once the rest of the header is filled in
+        std::atomic<unsigned int> ready;
+
+        unsigned long long bucketCount;
+        unsigned char reserved[ 40 ];
+    };
+
+    // check is the key XORed with data. Depth is in the top 8 bits of data and the node count in the rest, as in
+    // the other tables, and depth 0 is never stored
+    struct Entry
+    {
+        std::atomic<unsigned long long> check;
+        std::atomic<unsigned long long> data;
+    };
+
+    static const int BUCKET_ENTRIES = 4;
+
+    struct alignas( 64 ) Bucket
+    {
+        Entry entries[ BUCKET_ENTRIES ];
+    };
+
+    void* mapping;
+    Header* header;
+    Bucket* buckets;
+    unsigned long long bucketMask;
+    bool created;
+
+    // Searches on several threads can share the table too
+    std::atomic<unsigned long long> hits;
+
+public:
+    static const unsigned long long MAX_NODES;
+
+    SharedTable();
+    ~SharedTable();
+
+    /// <summary>
+    /// Create the table, or attach to it if another process already has
+    /// </summary>
+    /// <param name="name">the table's name, shared by all the processes using it</param>
+    /// <param name="megabytes">memory to use if the table is created, rounded down to a power of two number of buckets</param>
+    /// <returns><code>false</code> if the table can't be created or attached to</returns>
+    bool open( const std::string& name, size_t megabytes );
+
+    /// <summary>
+    /// Detach from the table
+    /// </summary>
+    void close();
+
+    bool isOpen() const
+    {
+        return buckets != nullptr;
+    }
+
+    /// <summary>
+    /// Returns true if this process created the table, false if it attached to one that was already there
+    /// </summary>
+    bool isCreated() const
+    {
+        return created;
+    }
+
+    /// <summary>
+    /// Look up the count for a position searched to a depth
+    /// </summary>
+    /// <param name="key">the position's Zobrist key</param>
+    /// <param name="depth">the search depth</param>
+    /// <param name="nodes">receives the leaf node count if found</param>
+    /// <returns>true if found</returns>
+    bool find( unsigned long long key, int depth, unsigned long long& nodes );
+
+    /// <summary>
+    /// Store the count for a position searched to a depth, replacing the shallowest entry in the bucket if it is full
+    /// </summary>
+    /// <param name="key">the position's Zobrist key</param>
+    /// <param name="depth">the search depth - ignored unless 1 to 255</param>
+    /// <param name="nodes">the leaf node count - ignored if over MAX_NODES</param>
+    void store( unsigned long long key, int depth, unsigned long long nodes );
+
+    unsigned long long getMegabytes() const
+    {
+        return buckets == nullptr ? 0 : ( header->bucketCount * sizeof( Bucket ) ) >> 20;
+    }
+
+    unsigned long long getHits() const
+    {
+        return hits;
+    }
+};
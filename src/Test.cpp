@@ -1,9 +1,45 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <thread>
 
+#include "AttackMap.h"
+#include "BatchCounter.h"
 #include "Fen.h"
 #include "Test.h"
 
+bool Test::copyMake = false;
+
+PerftCache* Test::cache = nullptr;
+int Test::cachePlies = 0;
+int Test::cacheMinimumDepth = 0;
+
+PerftTable* Test::table = nullptr;
+SharedTable* Test::sharedTable = nullptr;
+
+bool Test::symmetricKeys = false;
+
+Checkpoint* Test::checkpoint = nullptr;
+int Test::checkpointPlies = 1;
+
+int Test::breadthFirstPlies = 0;
+
+std::atomic<bool>* Test::stopSignal = nullptr;
+
+std::string Test::verifyAgainst;
+Test::Backend Test::verifyBackends[ 2 ];
+
+bool Test::statisticsEnabled = false;
+std::vector<Test::PlyStatistics> Test::statistics;
+int Test::statisticsDepth = 0;
+
 bool Test::perftDepth( int depth, const std::string& fen, bool divide )
 {
     if ( depth < 1 )
@@ -19,12 +55,21 @@ bool Test::perftDepth( int depth, const std::string& fen, bool divide )
 
     std::cout << fen << std::endl;
 
-    unsigned int actualResult = perftRun( depth, fen, divide );
+    NodeCount actualResult = perftRun( depth, fen, divide );
     std::cout << "  Depth: " << depth << ". Actual: " << actualResult << std::endl;
 
     return true;
 }
 
+unsigned long long Test::perftCount( int depth, const std::string& fen )
+{
+    std::unique_ptr<Board> board( Board::createBoard( fen ) );
+
+    setCacheMinimumDepth( depth );
+
+    return perftLoop( depth, board.get() );
+}
+
 bool Test::perftFen( const std::string& fenWithResults, bool divide )
 {
     if ( fenWithResults.empty() )
@@ -44,7 +89,7 @@ bool Test::perftFen( const std::string& fenWithResults, bool divide )
         std::string results = fenWithResults.substr( semicolon + 2 );
 
         int depth;
-        unsigned int actualResult;
+        NodeCount actualResult;
 
         std::cout << fen << std::endl;
 
@@ -61,7 +106,7 @@ bool Test::perftFen( const std::string& fenWithResults, bool divide )
             {
                 depth = atoi( token.substr( 0, split ).c_str() );
                 actualResult = perftRun( depth, fen, divide );
-                report( depth, atoi( token.substr( split + 1 ).c_str() ), actualResult );
+                report( depth, getExpected( token.substr( split + 1 ) ), actualResult );
             }
 
             results.erase( 0, pos + delimiter.length() );
@@ -74,7 +119,7 @@ bool Test::perftFen( const std::string& fenWithResults, bool divide )
         {
             depth = atoi( token.substr( 0, split ).c_str() );
             actualResult = perftRun( depth, fen, divide );
-            report( depth, atoi( token.substr( split + 1 ).c_str() ), actualResult );
+            report( depth, getExpected( token.substr( split + 1 ) ), actualResult );
         }
     }
     else if ( comma != SIZE_MAX )
@@ -83,7 +128,7 @@ bool Test::perftFen( const std::string& fenWithResults, bool divide )
         std::string results = fenWithResults.substr( comma + 1 );
 
         int depth = 1;
-        unsigned int actualResult;
+        NodeCount actualResult;
 
         std::cout << fen << std::endl;
 
@@ -96,7 +141,7 @@ bool Test::perftFen( const std::string& fenWithResults, bool divide )
             token = results.substr( 0, pos );
 
             actualResult = perftRun( depth, fen, divide );
-            report( depth, atoi( token.c_str() ), actualResult );
+            report( depth, getExpected( token ), actualResult );
 
             results.erase( 0, pos + delimiter.length() );
             depth++;
@@ -105,7 +150,7 @@ bool Test::perftFen( const std::string& fenWithResults, bool divide )
         // Get the last one
         token = results;
         actualResult = perftRun( depth, fen, divide );
-        report( depth, atoi( token.c_str() ), actualResult );
+        report( depth, getExpected( token ), actualResult );
     }
     else
     {
@@ -143,109 +188,1127 @@ bool Test::perftFile( const std::string& filename, bool divide )
     return true;
 }
 
-unsigned int Test::perftRun( int depth, const std::string& fen, bool divide )
+bool Test::perftBatch( int depth, const std::string& filename )
 {
-    // Prep here
+    if ( depth < 1 || depth > 2 )
+    {
+        std::cout << "Invalid batch depth: " << depth << std::endl;
+        return false;
+    }
 
-    Board* board = Board::createBoard( fen );
-    
-#if _DEBUG
-    if ( fen != board->toString() )
+    std::fstream file;
+    file.open( filename, std::ios::in );
+
+    if ( !file.is_open() )
     {
-        std::cout << "FEN conversion mismatch - check the differences are only in expected results:" << std::endl;
-        std::cout << "  From: [" << fen << "]" << std::endl;
-        std::cout << "  To  : [" << board->toString() << "]" << std::endl;
+        std::cout << "File was not opened: " << filename << std::endl;
+        return false;
     }
-#endif
 
-    // Run the test
+    // Read all the positions up front, ignoring any expected results
+    BatchCounter::Batch batch;
+    std::vector<std::string> fens;
+
+    std::string line;
+    while ( std::getline( file, line ) )
+    {
+        if ( line.empty() || line[ 0 ] == '#' )
+        {
+            continue;
+        }
+
+        std::string fen = line.substr( 0, line.find_first_of( ";," ) );
+
+        Board* board = Board::createBoard( fen );
+        batch.add( *board );
+        delete board;
+
+        fens.push_back( fen );
+    }
+
+    std::cout << "Counting " << fens.size() << " positions at depth " << depth << " (" << BatchCounter::getImplementationName() << ")" << std::endl;
+
+    std::vector<unsigned long long> counts( batch.size() );
 
     clock_t start = clock();
 
-    unsigned int nodes = divide ? divideLoop( depth, board) : perftLoop( depth, board );
+    BatchCounter::countMoves( batch, depth, counts.data() );
 
     clock_t end = clock();
 
-    // Tidy up and report
+    unsigned long long nodes = 0;
+    for ( size_t index = 0; index < fens.size(); index++ )
+    {
+        std::cout << "  " << counts[ index ] << " " << fens[ index ] << std::endl;
+        nodes += counts[ index ];
+    }
 
-    float elapsed = static_cast<float>( end - start ) / CLOCKS_PER_SEC;
-    float nps = elapsed == 0 ? 0 : static_cast<float>( nodes ) / elapsed;
+    double elapsed = static_cast<double>( end - start ) / CLOCKS_PER_SEC;
 
-    // This will give 0 if elapsed is close to zero - but not sure what to do with that other than continue
-    long lnps = std::lround( nps );
+    std::cout << "  Found " << nodes << " nodes in " << elapsed << "s (" << getNodesPerSecond( static_cast<double>( nodes ), elapsed ) << " nps)" << std::endl;
 
-    std::cout << "  Found " << nodes << " nodes in " << elapsed << "s (" << lnps << " nps)" << std::endl;
+    return true;
+}
 
-    return nodes;
+bool Test::perftBenchmark( int depth, const std::string& fen )
+{
+    if ( depth < 1 )
+    {
+        std::cout << "Invalid depth: " << depth << std::endl;
+        return false;
+    }
+    else if ( fen.empty() )
+    {
+        std::cout << "Missing FEN string" << std::endl;
+        return false;
+    }
+
+    std::cout << fen << std::endl;
+
+    const bool wasCopyMake = copyMake;
+
+    std::cout << "  Make/unmake:" << std::endl;
+    copyMake = false;
+
+    clock_t start = clock();
+    NodeCount makeUnmakeNodes = perftRun( depth, fen, false );
+    clock_t makeUnmakeTicks = clock() - start;
+
+    std::cout << "  Copy-make:" << std::endl;
+    copyMake = true;
+
+    start = clock();
+    NodeCount copyMakeNodes = perftRun( depth, fen, false );
+    clock_t copyMakeTicks = clock() - start;
+
+    copyMake = wasCopyMake;
+
+    if ( makeUnmakeNodes != copyMakeNodes )
+    {
+        std::cout << "  **ERROR** Node counts differ: " << makeUnmakeNodes << " and " << copyMakeNodes << std::endl;
+    }
+
+    if ( makeUnmakeTicks > 0 )
+    {
+        std::cout << "  Copy-make took " << std::lround( 100.0 * copyMakeTicks / makeUnmakeTicks ) << "% of the make/unmake time" << std::endl;
+    }
+
+    return true;
 }
 
-unsigned int Test::divideLoop( int depth, Board* board )
+bool Test::perftEstimate( int depth, const std::string& fen, unsigned long long samples, double seconds )
 {
-    unsigned int nodes = 0;
+    if ( depth < 1 )
+    {
+        std::cout << "Invalid depth: " << depth << std::endl;
+        return false;
+    }
+    else if ( fen.empty() )
+    {
+        std::cout << "Missing FEN string" << std::endl;
+        return false;
+    }
 
-    if ( depth == 0 )
+    std::cout << fen << std::endl;
+
+    Board* board = Board::createBoard( fen );
+
+    std::vector<Move> rootMoves;
+    board->getMoves( rootMoves );
+
+    // Sums for each root move and each ply, so that each root move's subtree is estimated on its own
+    struct Samples
     {
-        return 1;
+        double sum;
+        double sumOfSquares;
+        unsigned long long count;
+    };
+
+    const size_t strata = rootMoves.size();
+
+    std::vector<std::vector<Samples>> threadSamples;
+
+    std::atomic<unsigned long long> nextWalk( 0 );
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const std::chrono::steady_clock::time_point deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( seconds ) );
+
+    if ( depth > 1 && strata > 0 )
+    {
+        std::vector<std::thread> threads;
+        const unsigned int threadCount = std::max( 1u, std::thread::hardware_concurrency() );
+
+        threadSamples.assign( threadCount, std::vector<Samples>( strata * depth, Samples { 0, 0, 0 } ) );
+
+        for ( unsigned int loop = 0; loop < threadCount; loop++ )
+        {
+            threads.emplace_back( [ &, loop ]()
+            {
+                std::vector<Samples>& totals = threadSamples[ loop ];
+                std::random_device seed;
+                std::mt19937_64 random( seed() ^ loop );
+
+                std::vector<Move> moves;
+                moves.reserve( 256 );
+
+                for ( ;; )
+                {
+                    const unsigned long long walk = nextWalk++;
+
+                    if ( ( samples > 0 && walk >= samples ) || ( seconds > 0 && std::chrono::steady_clock::now() >= deadline ) )
+                    {
+                        break;
+                    }
+
+                    // Round robin over the root moves keeps the strata the same size
+                    const size_t stratum = walk % strata;
+
+                    Board position = *board;
+                    position.applyMove( rootMoves[ stratum ] );
+
+                    // Once a walk reaches a mate or stalemate, every deeper estimate from it is 0
+                    double product = 1;
+
+                    for ( int ply = 2; ply <= depth; ply++ )
+                    {
+                        if ( product != 0 )
+                        {
+                            moves.clear();
+                            position.getMoves( moves );
+
+                            product *= static_cast<double>( moves.size() );
+
+                            if ( !moves.empty() )
+                            {
+                                position.applyMove( moves[ std::uniform_int_distribution<size_t>( 0, moves.size() - 1 )( random ) ] );
+                            }
+                        }
+
+                        Samples& plySamples = totals[ stratum * depth + ply - 1 ];
+                        plySamples.sum += product;
+                        plySamples.sumOfSquares += product * product;
+                        plySamples.count++;
+                    }
+                }
+            } );
+        }
+
+        for ( std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); it++ )
+        {
+            it->join();
+        }
     }
 
-    std::vector<Move> moves;
-    moves.reserve( 256 );
+    const double elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
 
-    board->getMoves( moves );
+    // The estimate at a ply is the sum of the root moves' means, and its variance the sum of their means' variances
+    std::vector<double> estimates( depth + 1, 0 );
+    estimates[ 1 ] = static_cast<double>( strata );
 
-    // We could get an unfair advantage here by returning count of moves if depth is 1
-    // but we'd need to (a) still think about the divide thing and (b) admit we were no
-    // longer comparing like for like with motive-chess and it would be an meaningless win
+    std::cout << "  Ply 1: " << strata << " (exact)" << std::endl;
 
-    for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+    unsigned long long walks = 0;
+    bool complete = true;
+
+    for ( int ply = 2; ply <= depth; ply++ )
     {
-        const Move& move = *it;
+        double variance = 0;
 
-        Board::State undo = board->makeMove( move );
+        for ( size_t stratum = 0; stratum < strata; stratum++ )
+        {
+            Samples total { 0, 0, 0 };
+            for ( std::vector<std::vector<Samples>>::const_iterator it = threadSamples.cbegin(); it != threadSamples.cend(); it++ )
+            {
+                const Samples& plySamples = ( *it )[ stratum * depth + ply - 1 ];
+                total.sum += plySamples.sum;
+                total.sumOfSquares += plySamples.sumOfSquares;
+                total.count += plySamples.count;
+            }
 
-        unsigned long moveNodes = perftLoop( depth - 1, board );
-        nodes += moveNodes;
+            if ( total.count == 0 )
+            {
+                complete = false;
+                continue;
+            }
 
-        std::cout << "  " << move.toString() << " : " << moveNodes << " " << board->toString() << std::endl;
+            const double mean = total.sum / total.count;
+            estimates[ ply ] += mean;
 
-        board->unmakeMove( undo );
+            if ( total.count > 1 )
+            {
+                variance += std::max( 0.0, ( total.sumOfSquares - total.sum * mean ) / ( total.count - 1 ) ) / total.count;
+            }
+
+            if ( ply == depth )
+            {
+                walks += total.count;
+            }
+        }
+
+        // 95% confidence from the normal approximation
+        const double interval = 1.96 * std::sqrt( variance );
+
+        std::cout << std::fixed << std::setprecision( 0 ) << "  Ply " << ply << ": " << estimates[ ply ] << " +/- " << interval
+                  << " (" << std::setprecision( 2 ) << ( estimates[ ply ] == 0 ? 0 : 100 * interval / estimates[ ply ] ) << "%)"
+                  << std::defaultfloat << std::endl;
     }
 
-    return nodes;
+    if ( !complete )
+    {
+        std::cout << "  Not every root move was sampled - the estimates are too low" << std::endl;
+    }
+
+    std::cout << "  " << walks << " walks in " << elapsed << "s" << std::endl;
+
+    // Time an exact search of about a million nodes, at the deepest ply estimated to be that small, to predict the full search
+    int calibrationDepth = 1;
+    while ( calibrationDepth < depth && estimates[ calibrationDepth + 1 ] <= 1000000 )
+    {
+        calibrationDepth++;
+    }
+
+    // With the cache and tables off, as hits would make the search look faster than a full one would be
+    PerftCache* const savedCache = cache;
+    PerftTable* const savedTable = table;
+    SharedTable* const savedSharedTable = sharedTable;
+
+    cache = nullptr;
+    table = nullptr;
+    sharedTable = nullptr;
+
+    clock_t calibrationStart = clock();
+    unsigned long long calibrationNodes = perftLoop( calibrationDepth, board );
+    double calibrationElapsed = static_cast<double>( clock() - calibrationStart ) / CLOCKS_PER_SEC;
+
+    cache = savedCache;
+    table = savedTable;
+    sharedTable = savedSharedTable;
+
+    if ( calibrationElapsed > 0 )
+    {
+        const double nps = calibrationNodes / calibrationElapsed;
+
+        std::cout << std::fixed << std::setprecision( 0 ) << "  An exact search to depth " << depth << " would take about " << estimates[ depth ] / nps
+                  << "s at " << nps << " nps (measured at depth " << calibrationDepth << ")" << std::defaultfloat << std::endl;
+    }
+
+    delete board;
+
+    return true;
 }
 
-unsigned int Test::perftLoop( int depth, Board* board )
+bool Test::perftUnique( int depth, const std::string& fen, size_t megabytes, const std::string& spillFilename )
 {
-    unsigned int nodes = 0;
-
-    if ( depth == 0 )
+    if ( depth < 1 )
     {
-        return 1;
+        std::cout << "Invalid depth: " << depth << std::endl;
+        return false;
+    }
+    else if ( fen.empty() )
+    {
+        std::cout << "Missing FEN string" << std::endl;
+        return false;
     }
 
-    std::vector<Move> moves;
-    moves.reserve( 256 );
+    std::cout << fen << std::endl;
 
+    Board* board = Board::createBoard( fen );
+
+    std::vector<Move> moves;
     board->getMoves( moves );
 
-    // We could get an unfair advantage here by returning count of moves if depth is 1
-    // but we'd need to (a) still think about the divide thing and (b) admit we were no
-    // longer comparing like for like with motive-chess and it would be an meaningless win
+    PositionSet positions( depth, megabytes, spillFilename );
 
-    for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+    clock_t start = clock();
+
+    // Each thread takes the next root move that nobody has started on, with its own copy of the board
+    std::atomic<size_t> nextMove( 0 );
+
+    std::vector<std::thread> threads;
+    const unsigned int threadCount = std::max( 1u, std::thread::hardware_concurrency() );
+
+    for ( unsigned int loop = 0; loop < threadCount; loop++ )
     {
-        const Move& move = *it;
+        threads.emplace_back( [ & ]()
+        {
+            Board child = *board;
 
-        Board::State undo = board->makeMove( move );
+            for ( size_t index = nextMove++; index < moves.size(); index = nextMove++ )
+            {
+                Board::State state = child.makeMove( moves[ index ] );
+                uniqueLoop( 1, depth, &child, positions );
+                child.unmakeMove( state );
+            }
+        } );
+    }
 
-        nodes += perftLoop( depth - 1, board );
+    for ( std::vector<std::thread>::iterator it = threads.begin(); it != threads.end(); it++ )
+    {
+        it->join();
+    }
 
-        board->unmakeMove( undo );
+    for ( int ply = 1; ply <= depth; ply++ )
+    {
+        std::cout << "  Ply " << ply << ": " << positions.count( ply ) << " distinct positions" << std::endl;
     }
 
-    return nodes;
+    clock_t end = clock();
+
+    std::cout << "  Found in " << static_cast<float>( end - start ) / CLOCKS_PER_SEC << "s";
+
+    if ( positions.getSpilledRuns() > 0 )
+    {
+        std::cout << ", spilling " << positions.getSpilledKeys() << " keys to disk in " << positions.getSpilledRuns() << " runs";
+    }
+
+    std::cout << std::endl;
+
+    delete board;
+
+    return true;
 }
-void Test::report( int depth, unsigned int expected, unsigned int actual )
+
+NodeCount Test::perftRun( int depth, const std::string& fen, bool divide )
+{
+    // Prep here
+
+    std::unique_ptr<Board> rootBoard( Board::createBoard( fen ) );
+
+    // The board the search works on - the root, or the first ply of the copy-make stack
+    Board* board = rootBoard.get();
+
+#if _DEBUG
+    if ( fen != board->toString() )
+    {
+        std::cout << "FEN conversion mismatch - check the differences are only in expected results:" << std::endl;
+        std::cout << "  From: [" << fen << "]" << std::endl;
+        std::cout << "  To  : [" << board->toString() << "]" << std::endl;
+    }
+#endif
+
+    // For copy-make, one board per ply allocated up front - the root is the first, and each ply works on its own copy
+    std::vector<Board> plies;
+    if ( copyMake )
+    {
+        plies.assign( depth + 1, *board );
+        board = &plies[ 0 ];
+    }
+
+    setCacheMinimumDepth( depth );
+
+    // Run the test
+
+    clock_t start = clock();
+
+    NodeCount nodes;
+    if ( checkpoint != nullptr )
+    {
+        checkpoint->setRun( depth, board->toString() );
+    }
+
+    if ( statisticsEnabled )
+    {
+        statistics.assign( depth, PlyStatistics() );
+        statisticsDepth = depth;
+
+        nodes = perftLoop<true>( depth, board );
+    }
+    else if ( !verifyAgainst.empty() )
+    {
+        // The usual backend, and the same again with one thing changed
+        const bool wasVectorized = AttackMap::isVectorized();
+
+        verifyBackends[ 0 ] = { wasVectorized, copyMake };
+        verifyBackends[ 1 ] = verifyBackends[ 0 ];
+
+        if ( verifyAgainst == "scalar" || verifyAgainst == "avx2" )
+        {
+            verifyBackends[ 1 ].vectorized = verifyAgainst == "avx2";
+        }
+        else
+        {
+            verifyBackends[ 1 ].copyMake = verifyAgainst == "copymake";
+        }
+
+        if ( verifyBackends[ 1 ].vectorized == verifyBackends[ 0 ].vectorized && verifyBackends[ 1 ].copyMake == verifyBackends[ 0 ].copyMake )
+        {
+            std::cout << "  Verifying against " << verifyAgainst << ", which is already in use - both sides are the same" << std::endl;
+        }
+
+        // Both backends start from their own copy of the root, made with their own slider implementation
+        std::vector<Board> stacks[ 2 ];
+        stacks[ 0 ].assign( depth + 1, *board );
+
+        AttackMap::setVectorized( verifyBackends[ 1 ].vectorized );
+        Board* root = Board::createBoard( board->toString() );
+        stacks[ 1 ].assign( depth + 1, *root );
+        delete root;
+
+        AttackMap::setVectorized( wasVectorized );
+
+        unsigned long long verifiedNodes = 0;
+        std::vector<Move> path;
+
+        if ( !verifyLoop( depth, 0, stacks, path, verifiedNodes ) )
+        {
+            // Replay the path to show each position on the way to the difference
+            Board position = *board;
+
+            std::cout << "  Path: " << position.toString() << std::endl;
+            for ( std::vector<Move>::const_iterator it = path.cbegin(); it != path.cend(); it++ )
+            {
+                position.applyMove( *it );
+                std::cout << "    " << it->toString() << " -> " << position.toString() << std::endl;
+            }
+        }
+
+        AttackMap::setVectorized( wasVectorized );
+
+        nodes = verifiedNodes;
+    }
+    else if ( divide )
+    {
+        nodes = divideLoop( depth, board );
+    }
+    else if ( checkpoint != nullptr )
+    {
+        nodes = checkpointLoop( depth, board, 0, "" );
+    }
+    else if ( breadthFirstPlies > 0 && depth > 1 )
+    {
+        nodes = breadthFirstLoop( depth, board );
+    }
+    else
+    {
+        nodes = copyMake ? copyMakeLoop( depth, board ) : perftLoop( depth, board );
+    }
+
+    clock_t end = clock();
+
+    // Tidy up and report
+
+    double elapsed = static_cast<double>( end - start ) / CLOCKS_PER_SEC;
+
+    std::cout << "  Found " << nodes << " nodes in " << elapsed << "s (" << getNodesPerSecond( nodes.toDouble(), elapsed ) << " nps)" << std::endl;
+
+    if ( statisticsEnabled )
+    {
+        reportStatistics();
+    }
+
+    return nodes;
+}
+
+NodeCount Test::divideLoop( int depth, Board* board )
+{
+    NodeCount nodes;
+
+    if ( depth == 0 )
+    {
+        return 1;
+    }
+
+    std::vector<Move> moves;
+    moves.reserve( 256 );
+
+    board->getMoves( moves );
+
+    // We could get an unfair advantage here by returning count of moves if depth is 1
+    // but we'd need to (a) still think about the divide thing and (b) admit we were no
+    // longer comparing like for like with motive-chess and it would be an meaningless win
+
+    for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+    {
+        const Move& move = *it;
+
+        Board::State undo = board->makeMove( move );
+
+        // For copy-make the board is the root of the ply stack, so the search below copies into the plies after it
+        NodeCount moveNodes;
+        if ( checkpoint != nullptr )
+        {
+            moveNodes = checkpointLoop( depth - 1, board, 1, move.toString() );
+        }
+        else
+        {
+            moveNodes = copyMake ? copyMakeLoop( depth - 1, board ) : perftLoop( depth - 1, board );
+        }
+        nodes += moveNodes;
+
+        std::cout << "  " << move.toString() << " : " << moveNodes << " " << board->toString() << std::endl;
+
+        board->unmakeMove( undo );
+    }
+
+    return nodes;
+}
+
+template <bool withStatistics>
+unsigned long long Test::perftLoop( int depth, Board* board )
+{
+    unsigned long long nodes = 0;
+
+    if ( depth == 0 )
+    {
+        return 1;
+    }
+
+    // Already known? Not with statistics, which need every move to be made
+    const bool lookedUp = !withStatistics && isLookedUp( depth );
+    unsigned long long key = 0;
+
+    if ( lookedUp )
+    {
+        key = getKey( board );
+
+        if ( findNodes( key, depth, nodes ) )
+        {
+            return nodes;
+        }
+    }
+
+    std::vector<Move> moves;
+    moves.reserve( 256 );
+
+    board->getMoves( moves );
+
+    if ( !withStatistics && table != nullptr && depth - 1 >= table->getDiskMinimumDepth() )
+    {
+        prefetchChildren( board, moves, depth - 1 );
+    }
+
+    // The moves made here are counted in the statistics for the next ply, along with the branching factor here
+    PlyStatistics* plyStatistics = nullptr;
+
+    if ( withStatistics )
+    {
+        plyStatistics = &statistics[ statisticsDepth - depth ];
+        plyStatistics->positions++;
+        plyStatistics->maximumMoves = std::max<unsigned long long>( plyStatistics->maximumMoves, moves.size() );
+    }
+
+    // We could get an unfair advantage here by returning count of moves if depth is 1
+    // but we'd need to (a) still think about the divide thing and (b) admit we were no
+    // longer comparing like for like with motive-chess and it would be an meaningless win
+
+    for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+    {
+        const Move& move = *it;
+
+        Board::State undo = board->makeMove( move );
+
+        if ( withStatistics )
+        {
+            addStatistics( *plyStatistics, move, board );
+        }
+
+        nodes += perftLoop<withStatistics>( depth - 1, board );
+
+        board->unmakeMove( undo );
+
+        // Not checked at the last ply, where a subtree is too small for the wait to matter. A subtree cut short
+        // returns here too, so a partial count is never stored
+        if ( depth > 1 && isStopped() )
+        {
+            return nodes;
+        }
+    }
+
+    if ( lookedUp )
+    {
+        storeNodes( key, depth, nodes );
+    }
+
+    return nodes;
+}
+
+bool Test::verifyLoop( int depth, int ply, std::vector<Board> stacks[ 2 ], std::vector<Move>& path, unsigned long long& nodes )
+{
+    Board* boards[ 2 ];
+    for ( int side = 0; side < 2; side++ )
+    {
+        boards[ side ] = &stacks[ side ][ verifyBackends[ side ].copyMake ? ply : 0 ];
+    }
+
+    // The same moves should have led to the same position, however they were made. The full FEN is only compared
+    // above the leaves, where it is cheap next to generating the moves
+    if ( boards[ 0 ]->getZobristKey() != boards[ 1 ]->getZobristKey() || ( depth > 0 && boards[ 0 ]->toString() != boards[ 1 ]->toString() ) )
+    {
+        std::cout << "  **ERROR** Positions differ: " << boards[ 0 ]->toString() << " and " << boards[ 1 ]->toString() << std::endl;
+        return false;
+    }
+
+    if ( depth == 0 )
+    {
+        nodes++;
+        return true;
+    }
+
+    // Put the moves in the same order so that they can be compared
+    std::vector<Move> moves[ 2 ];
+    for ( int side = 0; side < 2; side++ )
+    {
+        AttackMap::setVectorized( verifyBackends[ side ].vectorized );
+        boards[ side ]->getMoves( moves[ side ] );
+
+        std::sort( moves[ side ].begin(), moves[ side ].end(), []( const Move& a, const Move& b )
+        {
+            return ( a.getFrom() << 10 | a.getTo() << 4 | a.getFlags() ) < ( b.getFrom() << 10 | b.getTo() << 4 | b.getFlags() );
+        } );
+    }
+
+    const bool sameMoves = std::equal( moves[ 0 ].cbegin(), moves[ 0 ].cend(), moves[ 1 ].cbegin(), moves[ 1 ].cend(), []( const Move& a, const Move& b )
+    {
+        return a.getFrom() == b.getFrom() && a.getTo() == b.getTo() && a.getFlags() == b.getFlags();
+    } );
+
+    if ( !sameMoves )
+    {
+        std::cout << "  **ERROR** Moves differ in " << boards[ 0 ]->toString() << std::endl;
+
+        for ( int side = 0; side < 2; side++ )
+        {
+            std::cout << "    " << ( side == 0 ? "Only from the usual backend:" : "Only from the verification backend:" );
+
+            for ( std::vector<Move>::const_iterator it = moves[ side ].cbegin(); it != moves[ side ].cend(); it++ )
+            {
+                bool found = false;
+                for ( std::vector<Move>::const_iterator other = moves[ side ^ 1 ].cbegin(); other != moves[ side ^ 1 ].cend() && !found; other++ )
+                {
+                    found = it->getFrom() == other->getFrom() && it->getTo() == other->getTo() && it->getFlags() == other->getFlags();
+                }
+
+                if ( !found )
+                {
+                    std::cout << " " << it->toString() << " (flags " << it->getFlags() << ")";
+                }
+            }
+
+            std::cout << std::endl;
+        }
+
+        return false;
+    }
+
+    for ( std::vector<Move>::const_iterator it = moves[ 0 ].cbegin(); it != moves[ 0 ].cend(); it++ )
+    {
+        path.push_back( *it );
+
+        Board::State undo[ 2 ] = { Board::State( *boards[ 0 ] ), Board::State( *boards[ 1 ] ) };
+
+        for ( int side = 0; side < 2; side++ )
+        {
+            AttackMap::setVectorized( verifyBackends[ side ].vectorized );
+
+            if ( verifyBackends[ side ].copyMake )
+            {
+                stacks[ side ][ ply + 1 ] = *boards[ side ];
+                stacks[ side ][ ply + 1 ].applyMove( *it );
+            }
+            else
+            {
+                undo[ side ] = boards[ side ]->makeMove( *it );
+            }
+        }
+
+        if ( !verifyLoop( depth - 1, ply + 1, stacks, path, nodes ) )
+        {
+            return false;
+        }
+
+        for ( int side = 0; side < 2; side++ )
+        {
+            if ( !verifyBackends[ side ].copyMake )
+            {
+                boards[ side ]->unmakeMove( undo[ side ] );
+            }
+        }
+
+        path.pop_back();
+    }
+
+    return true;
+}
+
+bool Test::setVerifyAgainst( const std::string& backend )
+{
+    if ( backend == "avx2" && !AttackMap::isAVX2Supported() )
+    {
+        std::cout << "AVX2 is not supported on this CPU" << std::endl;
+        return false;
+    }
+    else if ( backend != "scalar" && backend != "avx2" && backend != "copymake" && backend != "makeunmake" )
+    {
+        std::cout << "Unknown backend: " << backend << " - use scalar, avx2, copymake or makeunmake" << std::endl;
+        return false;
+    }
+
+    verifyAgainst = backend;
+
+    return true;
+}
+
+unsigned long long Test::copyMakeLoop( int depth, Board* ply )
+{
+    unsigned long long nodes = 0;
+
+    if ( depth == 0 )
+    {
+        return 1;
+    }
+
+    // Already known?
+    const bool lookedUp = isLookedUp( depth );
+    unsigned long long key = 0;
+
+    if ( lookedUp )
+    {
+        key = getKey( ply );
+
+        if ( findNodes( key, depth, nodes ) )
+        {
+            return nodes;
+        }
+    }
+
+    std::vector<Move> moves;
+    moves.reserve( 256 );
+
+    ply->getMoves( moves );
+
+    if ( table != nullptr && depth - 1 >= table->getDiskMinimumDepth() )
+    {
+        prefetchChildren( ply, moves, depth - 1 );
+    }
+
+    Board* child = ply + 1;
+
+    for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+    {
+        // Undoing the move is just going back to this ply's board
+        *child = *ply;
+        child->applyMove( *it );
+
+        nodes += copyMakeLoop( depth - 1, child );
+    }
+
+    if ( lookedUp )
+    {
+        storeNodes( key, depth, nodes );
+    }
+
+    return nodes;
+}
+
+NodeCount Test::checkpointLoop( int depth, Board* board, int ply, const std::string& moves )
+{
+    NodeCount nodes;
+
+    if ( checkpoint->find( moves, nodes ) )
+    {
+        return nodes;
+    }
+
+    if ( ply < checkpointPlies && depth > 1 )
+    {
+        std::vector<Move> children;
+        children.reserve( 256 );
+
+        board->getMoves( children );
+
+        for ( std::vector<Move>::const_iterator it = children.cbegin(); it != children.cend(); it++ )
+        {
+            Board::State undo = board->makeMove( *it );
+            nodes += checkpointLoop( depth - 1, board, ply + 1, moves.empty() ? it->toString() : moves + " " + it->toString() );
+            board->unmakeMove( undo );
+        }
+    }
+    else
+    {
+        // The ply stack has room for the whole search below the root, so copy-make can carry on from this board
+        nodes = copyMake ? copyMakeLoop( depth, board ) : perftLoop( depth, board );
+    }
+
+    checkpoint->record( moves, nodes );
+
+    return nodes;
+}
+
+NodeCount Test::breadthFirstLoop( int depth, Board* board )
+{
+    // A frontier position is known by its key, and the board and paths at the same index
+    struct Reached
+    {
+        unsigned long long key;
+        unsigned long long paths;
+        size_t index;
+    };
+
+    std::vector<Board> frontier( 1, *board );
+    std::vector<unsigned long long> paths( 1, 1 );
+
+    // Leave at least one ply for the depth-first search
+    const int plies = std::min( breadthFirstPlies, depth - 1 );
+
+    unsigned long long totalPaths = 1;
+
+    std::vector<Move> moves;
+    moves.reserve( 256 );
+
+    for ( int ply = 0; ply < plies; ply++ )
+    {
+        std::vector<Board> children;
+        std::vector<Reached> reached;
+
+        for ( size_t index = 0; index < frontier.size(); index++ )
+        {
+            moves.clear();
+            frontier[ index ].getMoves( moves );
+
+            for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+            {
+                children.push_back( frontier[ index ] );
+                children.back().applyMove( *it );
+
+                reached.push_back( Reached { getKey( &children.back() ), paths[ index ], children.size() - 1 } );
+            }
+        }
+
+        // Sort and merge, so that the frontier is read in order rather than hashed into
+        std::sort( reached.begin(), reached.end(), []( const Reached& a, const Reached& b ) { return a.key < b.key; } );
+
+        frontier.clear();
+        paths.clear();
+        totalPaths = 0;
+
+        for ( std::vector<Reached>::const_iterator it = reached.cbegin(); it != reached.cend(); it++ )
+        {
+            if ( it != reached.cbegin() && it->key == ( it - 1 )->key )
+            {
+                paths.back() += it->paths;
+            }
+            else
+            {
+                frontier.push_back( children[ it->index ] );
+                paths.push_back( it->paths );
+            }
+
+            totalPaths += it->paths;
+        }
+    }
+
+    std::cout << "  Ply " << plies << " frontier: " << frontier.size() << " distinct positions from " << totalPaths << " paths" << std::endl;
+
+    // For copy-make each frontier position in turn is copied to the root of its own ply stack
+    std::vector<Board> stack;
+    if ( copyMake )
+    {
+        stack.assign( depth - plies + 1, *board );
+    }
+
+    NodeCount nodes;
+
+    for ( size_t index = 0; index < frontier.size(); index++ )
+    {
+        unsigned long long positionNodes;
+
+        if ( copyMake )
+        {
+            stack[ 0 ] = frontier[ index ];
+            positionNodes = copyMakeLoop( depth - plies, &stack[ 0 ] );
+        }
+        else
+        {
+            positionNodes = perftLoop( depth - plies, &frontier[ index ] );
+        }
+
+        nodes += NodeCount::multiply( paths[ index ], positionNodes );
+    }
+
+    return nodes;
+}
+
+void Test::setCacheMinimumDepth( int depth )
+{
+    // Depth 1 counts are too cheap to be worth caching
+    cacheMinimumDepth = std::max( 2, depth - cachePlies );
+}
+
+bool Test::isLookedUp( int depth )
+{
+    return ( cache != nullptr && depth >= cacheMinimumDepth ) || ( ( table != nullptr || sharedTable != nullptr ) && depth >= 2 );
+}
+
+bool Test::findNodes( unsigned long long key, int depth, unsigned long long& nodes )
+{
+    unsigned long long foundNodes;
+
+    if ( ( cache != nullptr && depth >= cacheMinimumDepth && cache->find( key, depth, foundNodes ) ) ||
+         ( sharedTable != nullptr && depth >= 2 && sharedTable->find( key, depth, foundNodes ) ) ||
+         ( table != nullptr && depth >= 2 && table->find( key, depth, foundNodes ) ) )
+    {
+        nodes = foundNodes;
+        return true;
+    }
+
+    return false;
+}
+
+void Test::storeNodes( unsigned long long key, int depth, unsigned long long nodes )
+{
+    if ( cache != nullptr && depth >= cacheMinimumDepth )
+    {
+        cache->store( key, depth, nodes );
+    }
+
+    if ( sharedTable != nullptr && depth >= 2 )
+    {
+        sharedTable->store( key, depth, nodes );
+    }
+
+    if ( table != nullptr && depth >= 2 )
+    {
+        table->store( key, depth, nodes );
+    }
+}
+
+void Test::prefetchChildren( const Board* board, const std::vector<Move>& moves, int depth )
+{
+    for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+    {
+        Board child = *board;
+        child.applyMove( *it );
+
+        table->prefetch( getKey( &child ), depth );
+    }
+}
+
+void Test::uniqueLoop( int ply, int depth, Board* board, PositionSet& positions )
+{
+    if ( !positions.insert( ply, board->getPositionKey() ) || ply == depth )
+    {
+        return;
+    }
+
+    std::vector<Move> moves;
+    moves.reserve( 256 );
+
+    board->getMoves( moves );
+
+    for ( std::vector<Move>::const_iterator it = moves.cbegin(); it != moves.cend(); it++ )
+    {
+        Board::State state = board->makeMove( *it );
+        uniqueLoop( ply + 1, depth, board, positions );
+        board->unmakeMove( state );
+    }
+}
+
+void Test::addStatistics( PlyStatistics& plyStatistics, const Move& move, Board* board )
+{
+    plyStatistics.nodes++;
+
+    if ( move.isCapture() )
+    {
+        plyStatistics.captures++;
+    }
+
+    if ( move.getFlags() == Move::EN_PASSANT_CAPTURE )
+    {
+        plyStatistics.enPassant++;
+    }
+    else if ( move.getFlags() == Move::KINGSIDE_CASTLE || move.getFlags() == Move::QUEENSIDE_CASTLE )
+    {
+        plyStatistics.castles++;
+    }
+
+    if ( move.isPromotion() )
+    {
+        plyStatistics.promotions++;
+    }
+
+    const unsigned long long checkers = board->getCheckers();
+
+    if ( checkers == 0 )
+    {
+        return;
+    }
+
+    plyStatistics.checks++;
+
+    // A single check from anything other than the piece that moved - or the rook, for castling - was uncovered by
+    // the move. As in the published tables, a double check is only counted as a double check
+    unsigned long long moved = 1ull << move.getTo();
+
+    if ( move.getFlags() == Move::KINGSIDE_CASTLE )
+    {
+        moved |= 1ull << ( move.getTo() - 1 );
+    }
+    else if ( move.getFlags() == Move::QUEENSIDE_CASTLE )
+    {
+        moved |= 1ull << ( move.getTo() + 1 );
+    }
+
+    if ( checkers & ( checkers - 1 ) )
+    {
+        plyStatistics.doubleChecks++;
+    }
+    else if ( checkers & ~moved )
+    {
+        plyStatistics.discoveredChecks++;
+    }
+
+    std::vector<Move> replies;
+    board->getMoves( replies );
+
+    if ( replies.empty() )
+    {
+        plyStatistics.checkmates++;
+    }
+}
+
+void Test::reportStatistics()
+{
+    std::cout << std::setw( 7 ) << "Depth" << std::setw( 16 ) << "Nodes" << std::setw( 14 ) << "Captures" << std::setw( 10 ) << "E.p."
+              << std::setw( 10 ) << "Castles" << std::setw( 12 ) << "Promotions" << std::setw( 12 ) << "Checks" << std::setw( 12 ) << "Discovered"
+              << std::setw( 10 ) << "Double" << std::setw( 12 ) << "Checkmates" << std::setw( 10 ) << "Mean BF" << std::setw( 8 ) << "Max BF" << std::endl;
+
+    // The branching factor on each row is that of the positions one ply up, which the row's moves were made from
+    for ( size_t ply = 0; ply < statistics.size(); ply++ )
+    {
+        const PlyStatistics& plyStatistics = statistics[ ply ];
+
+        const double meanMoves = plyStatistics.positions == 0 ? 0 : static_cast<double>( plyStatistics.nodes ) / plyStatistics.positions;
+
+        std::cout << std::setw( 7 ) << ply + 1 << std::setw( 16 ) << plyStatistics.nodes << std::setw( 14 ) << plyStatistics.captures
+                  << std::setw( 10 ) << plyStatistics.enPassant << std::setw( 10 ) << plyStatistics.castles << std::setw( 12 ) << plyStatistics.promotions
+                  << std::setw( 12 ) << plyStatistics.checks << std::setw( 12 ) << plyStatistics.discoveredChecks << std::setw( 10 ) << plyStatistics.doubleChecks
+                  << std::setw( 12 ) << plyStatistics.checkmates << std::setw( 10 ) << std::fixed << std::setprecision( 2 ) << meanMoves
+                  << std::defaultfloat << std::setw( 8 ) << plyStatistics.maximumMoves << std::endl;
+    }
+}
+
+NodeCount Test::getExpected( const std::string& text )
+{
+    NodeCount expected;
+
+    if ( !NodeCount::parse( text, expected ) )
+    {
+        std::cout << "  Expected result could not be read: " << text << std::endl;
+    }
+
+    return expected;
+}
+
+std::string Test::getNodesPerSecond( double nodes, double elapsed )
+{
+    // This will give 0 if elapsed is close to zero - but not sure what to do with that other than continue
+    std::stringstream nps;
+    nps << std::fixed << std::setprecision( 0 ) << ( elapsed == 0 ? 0 : nodes / elapsed );
+
+    return nps.str();
+}
+
+void Test::report( int depth, const NodeCount& expected, const NodeCount& actual )
 {
     if ( expected != actual )
     {
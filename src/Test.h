@@ -1,19 +1,314 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 
 #include "Board.h"
+#include "Checkpoint.h"
+#include "NodeCount.h"
+#include "PerftCache.h"
+#include "PerftTable.h"
+#include "PositionSet.h"
+#include "SharedTable.h"
 
 class Test
 {
+    // The server runs its own searches over the root moves
+    friend class Server;
+
 private:
-    static unsigned int perftRun( int depth, const std::string& fen, bool divide );
-    static unsigned int divideLoop( int depth, Board* board );
-    static unsigned int perftLoop( int depth, Board* board );
+    static bool copyMake;
+
+    // Results cache, looked up for positions with at least cacheMinimumDepth still to search
+    static PerftCache* cache;
+    static int cachePlies;
+    static int cacheMinimumDepth;
+
+    // Transposition table, looked up for positions with at least 2 plies still to search
+    static PerftTable* table;
+
+    // Transposition table shared with other processes, looked up before the table of our own
+    static SharedTable* sharedTable;
+
+    // Look positions up by the key shared with their color-flipped mirrors
+    static bool symmetricKeys;
+
+    // Finished subtrees, recorded down to checkpointPlies below the root
+    static Checkpoint* checkpoint;
+    static int checkpointPlies;
+
+    /// <summary>
+    /// Counts for the moves made at one ply, as in the published perft tables, and how many moves there were from
+    /// each position at the ply before
+    /// </summary>
+    struct PlyStatistics
+    {
+        unsigned long long nodes;
+        unsigned long long captures;
+        unsigned long long enPassant;
+        unsigned long long castles;
+        unsigned long long promotions;
+        unsigned long long checks;
+        unsigned long long discoveredChecks;
+        unsigned long long doubleChecks;
+        unsigned long long checkmates;
+
+        unsigned long long positions;
+        unsigned long long maximumMoves;
+    };
+
+    // Statistics for each ply of the search in progress, when enabled
+    static bool statisticsEnabled;
+    static std::vector<PlyStatistics> statistics;
+    static int statisticsDepth;
+
+    /// <summary>
+    /// One way of generating moves and stepping through the tree, for verification
+    /// </summary>
+    struct Backend
+    {
+        bool vectorized;
+        bool copyMake;
+    };
+
+    // When verifying, the name of the backend to check the usual one against, and the two backends for the search in
+    // progress - the usual one first
+    static std::string verifyAgainst;
+    static Backend verifyBackends[ 2 ];
+
+    // Plies to expand breadth-first before searching depth-first, or 0 to search depth-first from the root
+    static int breadthFirstPlies;
+
+    // Set by the server to abandon its search - perftLoop returns early once it is, without storing the partial counts
+    static std::atomic<bool>* stopSignal;
+
+    static NodeCount perftRun( int depth, const std::string& fen, bool divide );
+    static NodeCount divideLoop( int depth, Board* board );
+
+    /// <summary>
+    /// The depth-first search
+    /// </summary>
+    /// <typeparam name="withStatistics">true to count the detail in the statistics as well as the nodes - the
+    /// count-only search is a separate instantiation with none of that code</typeparam>
+    /// <param name="depth">the remaining depth</param>
+    /// <param name="board">the position</param>
+    /// <returns>the number of leaf nodes</returns>
+    template <bool withStatistics = false>
+    static unsigned long long perftLoop( int depth, Board* board );
+
+    /// <summary>
+    /// As perftLoop, but each ply copies the board into the next entry of the ply stack and applies the move there,
+    /// so there is nothing to undo
+    /// </summary>
+    /// <param name="depth">the remaining depth</param>
+    /// <param name="ply">this ply's board, with room for depth more boards after it</param>
+    /// <returns>the number of leaf nodes</returns>
+    static unsigned long long copyMakeLoop( int depth, Board* ply );
+
+    /// <summary>
+    /// Search a subtree through the checkpoint - a subtree that was finished before is not searched again, and
+    /// one that is searched now is recorded once it's finished. Down to checkpointPlies below the root, the
+    /// subtrees below this one are each checkpointed too
+    /// </summary>
+    /// <param name="depth">the remaining depth</param>
+    /// <param name="board">the position at the top of the subtree</param>
+    /// <param name="ply">the ply of this position</param>
+    /// <param name="moves">the moves from the root to this position</param>
+    /// <returns>the number of leaf nodes</returns>
+    static NodeCount checkpointLoop( int depth, Board* board, int ply, const std::string& moves );
+
+    /// <summary>
+    /// Walk the tree with the usual backend and the verification backend side by side, stopping at the first
+    /// position where they don't agree on the position or its moves
+    /// </summary>
+    /// <param name="depth">the remaining depth</param>
+    /// <param name="ply">the ply of this position</param>
+    /// <param name="stacks">a ply stack for each backend - for make/unmake only the first board is used</param>
+    /// <param name="path">the moves from the root, with the move that led to a difference left on it</param>
+    /// <param name="nodes">the leaf nodes counted</param>
+    /// <returns><code>false</code> at the first difference, once it is reported</returns>
+    static bool verifyLoop( int depth, int ply, std::vector<Board> stacks[ 2 ], std::vector<Move>& path, unsigned long long& nodes );
+
+    /// <summary>
+    /// Expand the root breadth-first for breadthFirstPlies plies, a ply at a time. After each ply the frontier is
+    /// sorted by key and identical positions are merged into one, with the number of paths that reach it. Each
+    /// position left in the frontier is then searched depth-first just once and its count multiplied by its paths
+    /// </summary>
+    /// <param name="depth">the search depth</param>
+    /// <param name="board">the root position</param>
+    /// <returns>the number of leaf nodes</returns>
+    static NodeCount breadthFirstLoop( int depth, Board* board );
+
+    /// <summary>
+    /// Set the shallowest depth looked up in the cache for a search from the root to this depth
+    /// </summary>
+    static void setCacheMinimumDepth( int depth );
+
+    /// <summary>
+    /// Returns true if a position with this depth still to search is looked up in the cache or table
+    /// </summary>
+    static bool isLookedUp( int depth );
+
+    /// <summary>
+    /// Returns true if the search has been told to stop
+    /// </summary>
+    static bool isStopped()
+    {
+        return stopSignal != nullptr && stopSignal->load( std::memory_order_relaxed );
+    }
+
+    /// <summary>
+    /// The key to look a position up by - plain or symmetric
+    /// </summary>
+    static unsigned long long getKey( const Board* board )
+    {
+        return symmetricKeys ? board->getSymmetricZobristKey() : board->getZobristKey();
+    }
+
+    /// <summary>
+    /// Look a position up in the cache and the table
+    /// </summary>
+    /// <param name="key">the position's Zobrist key</param>
+    /// <param name="depth">the depth still to search</param>
+    /// <param name="nodes">receives the leaf node count if found</param>
+    /// <returns>true if found</returns>
+    static bool findNodes( unsigned long long key, int depth, unsigned long long& nodes );
+
+    /// <summary>
+    /// Store a position's count in the cache and the table
+    /// </summary>
+    static void storeNodes( unsigned long long key, int depth, unsigned long long nodes );
+
+    /// <summary>
+    /// Ask the table to read its disk tier for each child position, so that the reads overlap searching the earlier children
+    /// </summary>
+    /// <param name="board">the parent position</param>
+    /// <param name="moves">the parent's moves</param>
+    /// <param name="depth">the depth still to search from the children</param>
+    static void prefetchChildren( const Board* board, const std::vector<Move>& moves, int depth );
+
+    /// <summary>
+    /// Add a position and everything below it to the set of distinct positions. A position that is already in the
+    /// set was reached before at the same ply, so everything below it is already there too
+    /// </summary>
+    /// <param name="ply">the ply of this position</param>
+    /// <param name="depth">the deepest ply</param>
+    /// <param name="board">the position</param>
+    /// <param name="positions">the distinct positions at each ply</param>
+    static void uniqueLoop( int ply, int depth, Board* board, PositionSet& positions );
+
+    /// <summary>
+    /// Count a move that has just been made in the statistics for its ply
+    /// </summary>
+    /// <param name="plyStatistics">the statistics for the ply the move was made at</param>
+    /// <param name="move">the move</param>
+    /// <param name="board">the position after the move</param>
+    static void addStatistics( PlyStatistics& plyStatistics, const Move& move, Board* board );
 
-    static void report( int depth, unsigned int expected, unsigned int actual );
+    static void reportStatistics();
+
+    /// <summary>
+    /// Read an expected result, reporting it if it can't be read
+    /// </summary>
+    static NodeCount getExpected( const std::string& text );
+
+    /// <summary>
+    /// Nodes per second as a whole number, worked out in floating point so that it can't overflow
+    /// </summary>
+    static std::string getNodesPerSecond( double nodes, double elapsed );
+
+    static void report( int depth, const NodeCount& expected, const NodeCount& actual );
 
 public:
+    /// <summary>
+    /// Choose between make/unmake (the default) and copy-make for the searches that follow
+    /// </summary>
+    /// <param name="enabled">true to copy the board at every ply rather than undoing moves</param>
+    static void setCopyMake( bool enabled )
+    {
+        copyMake = enabled;
+    }
+
+    /// <summary>
+    /// Use a results cache for the searches that follow
+    /// </summary>
+    /// <param name="cache">an open cache, or nullptr for none</param>
+    /// <param name="plies">how many plies below the root to look up as well as the root itself</param>
+    static void setCache( PerftCache* cache, int plies )
+    {
+        Test::cache = cache;
+        cachePlies = plies;
+    }
+
+    /// <summary>
+    /// Use a transposition table for the searches that follow
+    /// </summary>
+    /// <param name="table">the table, or nullptr for none</param>
+    static void setTable( PerftTable* table )
+    {
+        Test::table = table;
+    }
+
+    /// <summary>
+    /// Use a transposition table shared with other processes for the searches that follow, as well as or instead of
+    /// the table of our own
+    /// </summary>
+    /// <param name="table">an open shared table, or nullptr for none</param>
+    static void setSharedTable( SharedTable* table )
+    {
+        sharedTable = table;
+    }
+
+    /// <summary>
+    /// Look positions up in the cache and table by a key they share with their color-flipped mirrors, so that
+    /// both use the same entry
+    /// </summary>
+    /// <param name="enabled">true for symmetric keys</param>
+    static void setSymmetricKeys( bool enabled )
+    {
+        symmetricKeys = enabled;
+    }
+
+    /// <summary>
+    /// Record finished subtrees of the searches that follow, and skip those already recorded
+    /// </summary>
+    /// <param name="checkpoint">an open checkpoint, or nullptr for none</param>
+    /// <param name="plies">how many plies below the root to record subtrees, 1 for just the root moves</param>
+    static void setCheckpoint( Checkpoint* checkpoint, int plies )
+    {
+        Test::checkpoint = checkpoint;
+        checkpointPlies = plies;
+    }
+
+    /// <summary>
+    /// Count captures, checks and so on at each ply of the searches that follow, as well as the nodes. These
+    /// searches use make/unmake from the root and don't use the cache or table
+    /// </summary>
+    /// <param name="enabled">true for statistics</param>
+    static void setStatistics( bool enabled )
+    {
+        statisticsEnabled = enabled;
+    }
+
+    /// <summary>
+    /// Check the searches that follow against another backend, move set by move set, instead of just counting.
+    /// The other backend is the usual one - as chosen by the CPU and -copy - with one thing changed
+    /// </summary>
+    /// <param name="backend">"scalar" or "avx2" to check against that slider implementation, "copymake" or
+    /// "makeunmake" to check against that way of stepping through the tree</param>
+    /// <returns><code>false</code> if the backend is unknown or not supported</returns>
+    static bool setVerifyAgainst( const std::string& backend );
+
+    /// <summary>
+    /// Expand the first plies of the searches that follow breadth-first, merging transpositions as it goes, and
+    /// search depth-first from there
+    /// </summary>
+    /// <param name="plies">plies to expand breadth-first, or 0 to search depth-first from the root</param>
+    static void setBreadthFirst( int plies )
+    {
+        breadthFirstPlies = plies;
+    }
+
     /// <summary>
     /// Do a depth search with the provided FEN string and report the results
     /// </summary>
@@ -22,6 +317,15 @@ public:
     /// <returns></returns>
     static bool perftDepth( int depth, const std::string& fen, bool divide );
 
+    /// <summary>
+    /// Count the leaf nodes to a depth without reporting anything, with the cache and table in use - for the units
+    /// of a distributed search
+    /// </summary>
+    /// <param name="depth">the search depth</param>
+    /// <param name="fen">the FEN string</param>
+    /// <returns>the number of leaf nodes</returns>
+    static unsigned long long perftCount( int depth, const std::string& fen );
+
     /// <summary>
     /// Read a FEN string and the expected results and perform a search to check for matching results
     /// </summary>
@@ -35,4 +339,44 @@ public:
     /// <param name="filename">the file to read</param>
     /// <returns><code>false</code> if the file fails to open</returns>
     static bool perftFile( const std::string& filename, bool divide );
+
+    /// <summary>
+    /// Read a file of FEN strings and count the leaf nodes of each at depth 1 or 2 as one batch, using the SIMD batch counter
+    /// </summary>
+    /// <param name="depth">the search depth, 1 or 2</param>
+    /// <param name="filename">the file to read, in the same format as for <code>perftFile</code></param>
+    /// <returns><code>false</code> if the file fails to open or the depth is not supported</returns>
+    static bool perftBatch( int depth, const std::string& filename );
+
+    /// <summary>
+    /// Do the same depth search with make/unmake and then with copy-make and compare the times
+    /// </summary>
+    /// <param name="depth">the search depth</param>
+    /// <param name="fen">the FEN string</param>
+    /// <returns></returns>
+    static bool perftBenchmark( int depth, const std::string& fen );
+
+    /// <summary>
+    /// Estimate the leaf nodes at each ply down to a depth by random walks, rather than searching. Each walk picks
+    /// a move at random at each ply, and the product of the number of moves along the way is an unbiased estimate
+    /// of the count at each ply. Walks are shared evenly between the root moves (stratified by root move) and run on
+    /// as many threads as there are cores. Also times a small exact search to predict how long the real one would take
+    /// </summary>
+    /// <param name="depth">the search depth</param>
+    /// <param name="fen">the FEN string</param>
+    /// <param name="samples">the number of walks, or 0 for no limit</param>
+    /// <param name="seconds">how long to walk for, or 0 for no limit</param>
+    /// <returns></returns>
+    static bool perftEstimate( int depth, const std::string& fen, unsigned long long samples, double seconds );
+
+    /// <summary>
+    /// Count the distinct positions at each ply down to a depth, rather than the paths to them. The root's moves are
+    /// shared out between as many threads as there are cores
+    /// </summary>
+    /// <param name="depth">the search depth</param>
+    /// <param name="fen">the FEN string</param>
+    /// <param name="megabytes">memory to keep keys in before spilling them to disk</param>
+    /// <param name="spillFilename">the file for spilled keys, deleted afterwards</param>
+    /// <returns></returns>
+    static bool perftUnique( int depth, const std::string& fen, size_t megabytes, const std::string& spillFilename );
 };
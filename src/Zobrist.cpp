@@ -0,0 +1,46 @@
+#include "Zobrist.h"
+
+unsigned long long Zobrist::pieceKeys[ 2 ][ 6 ][ 64 ];
+unsigned long long Zobrist::castlingKeys[ 16 ];
+unsigned long long Zobrist::enPassantKeys[ 8 ];
+unsigned long long Zobrist::blackToMoveKey;
+
+void Zobrist::initialize()
+{
+    unsigned long long state = 0x7065726674ull; // "perft"
+
+    for ( unsigned short color = 0; color < 2; color++ )
+    {
+        for ( unsigned short piece = 0; piece < 6; piece++ )
+        {
+            for ( unsigned short square = 0; square < 64; square++ )
+            {
+                pieceKeys[ color ][ piece ][ square ] = nextRandom( state );
+            }
+        }
+    }
+
+    // No rights at all is the common case deep in a search, so leave it as zero
+    castlingKeys[ 0 ] = 0;
+    for ( unsigned short rights = 1; rights < 16; rights++ )
+    {
+        castlingKeys[ rights ] = nextRandom( state );
+    }
+
+    for ( unsigned short file = 0; file < 8; file++ )
+    {
+        enPassantKeys[ file ] = nextRandom( state );
+    }
+
+    blackToMoveKey = nextRandom( state );
+}
+
+unsigned long long Zobrist::nextRandom( unsigned long long& state )
+{
+    unsigned long long value = ( state += 0x9E3779B97F4A7C15ull );
+
+    value = ( value ^ ( value >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+    value = ( value ^ ( value >> 27 ) ) * 0x94D049BB133111EBull;
+
+    return value ^ ( value >> 31 );
+}
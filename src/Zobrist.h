@@ -0,0 +1,53 @@
+#pragma once
+
+/// <summary>
+/// Random keys for Zobrist hashing - a position's key is the XOR of the keys for each piece on its square, the
+/// castling rights, the ep file and the side to move.
+/// Keys are written to disk by the perft cache, so they come from a fixed seed and must never change without
+/// changing the cache format version
+/// </summary>
+class Zobrist
+{
+private:
+    static unsigned long long pieceKeys[ 2 ][ 6 ][ 64 ];
+    static unsigned long long castlingKeys[ 16 ];
+    static unsigned long long enPassantKeys[ 8 ];
+    static unsigned long long blackToMoveKey;
+
+    /// <summary>
+    /// SplitMix64 - small, fast and gives the same sequence on every platform
+    /// </summary>
+    static unsigned long long nextRandom( unsigned long long& state );
+
+public:
+    static void initialize();
+
+    /// <summary>
+    /// Key for a piece on a square
+    /// </summary>
+    /// <param name="color">0 for white, 1 for black</param>
+    /// <param name="piece">the piece type, 0 (pawn) to 5 (king)</param>
+    /// <param name="square">the square index</param>
+    static unsigned long long getPieceKey( unsigned short color, unsigned short piece, unsigned long square )
+    {
+        return pieceKeys[ color ][ piece ][ square ];
+    }
+
+    /// <summary>
+    /// Key for a set of castling rights - one entry per combination, so no need to XOR the individual rights
+    /// </summary>
+    static unsigned long long getCastlingKey( unsigned char castlingRights )
+    {
+        return castlingKeys[ castlingRights ];
+    }
+
+    static unsigned long long getEnPassantKey( unsigned short file )
+    {
+        return enPassantKeys[ file ];
+    }
+
+    static unsigned long long getBlackToMoveKey()
+    {
+        return blackToMoveKey;
+    }
+};
@@ -1,13 +1,24 @@
 // perft.cpp : This file contains the 'main' function. Program execution begins and ends there.
 //
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <thread>
 
+#include "AttackMap.h"
+#include "BatchCounter.h"
 #include "BitBoard.h"
+#include "Checkpoint.h"
+#include "Distributed.h"
 #include "Fen.h"
+#include "PerftCache.h"
+#include "PerftTable.h"
+#include "Server.h"
+#include "SharedTable.h"
 #include "Test.h"
 #include "VersionInfo.h"
+#include "Zobrist.h"
 
 void dumpCommandLine( int argc, const char** argv );
 bool processCommandLine( int argc, const char** argv );
@@ -16,14 +27,18 @@ int main( int argc, const char** argv )
 {
     std::unique_ptr<VersionInfo> versionInfo = VersionInfo::getVersionInfo();
 
+    // When serving, stdout carries nothing but answers to commands, so the banner goes to stderr instead
+    const bool serving = std::find( argv + 1, argv + argc, std::string( "serve" ) ) != argv + argc;
+    std::ostream& banner = serving ? std::cerr : std::cout;
+
     if ( versionInfo->isAvailable() )
     {
-        std::cout << versionInfo->getCompanyName() << " " << versionInfo->getProductName() << " version " << versionInfo->getProductVersion() << std::endl;
-        std::cout << std::endl;
+        banner << versionInfo->getCompanyName() << " " << versionInfo->getProductName() << " version " << versionInfo->getProductVersion() << std::endl;
+        banner << std::endl;
     }
     else
     {
-        std::cout << "No version info available" << std::endl;
+        banner << "No version info available" << std::endl;
     }
 
 #if _DEBUG
@@ -35,6 +50,9 @@ int main( int argc, const char** argv )
     if ( argc > 1 )
     {
         BitBoard::initialize();
+        Zobrist::initialize();
+        AttackMap::initialize();
+        BatchCounter::initialize();
 
         commandLineOK = processCommandLine( argc, argv );
     }
@@ -47,7 +65,60 @@ int main( int argc, const char** argv )
         std::cout << "  perft [depth] [fen]   - perform a search using a depth and FEN string" << std::endl;
         std::cout << "  perft fen [fen]       - perform a search using a FEN string with expected results" << std::endl;
         std::cout << "  perft file [filename] - perform searches read from a file as FEN strings with expected results" << std::endl;
+        std::cout << "  perft batch [depth] [filename]" << std::endl;
+        std::cout << "                        - count moves at depth 1 or 2 for all positions in a file at once" << std::endl;
+        std::cout << "  perft benchmark [depth] [fen]" << std::endl;
+        std::cout << "                        - time a search with make/unmake against the same search with copy-make" << std::endl;
+        std::cout << "  perft estimate [depth] [fen]" << std::endl;
+        std::cout << "                        - estimate the node counts to a depth by random sampling, and how long a search would take" << std::endl;
+        std::cout << "  perft unique [depth] [fen]" << std::endl;
+        std::cout << "                        - count the distinct positions at each ply rather than the paths to them" << std::endl;
+        std::cout << "  perft distribute [depth] [fen]" << std::endl;
+        std::cout << "                        - split a search into units at -split plies and coordinate worker processes searching them" << std::endl;
+        std::cout << "  perft worker [host] [port]" << std::endl;
+        std::cout << "                        - search units for the coordinator at this address until it finishes" << std::endl;
+        std::cout << "  perft split [depth] [ply] [fen]" << std::endl;
+        std::cout << "                        - split a search into units at a ply and write them to -shards files for separate runs" << std::endl;
+        std::cout << "  perft run-unit [filename]" << std::endl;
+        std::cout << "                        - search the units in a file from split and write a result file beside it" << std::endl;
+        std::cout << "  perft reduce [filenames]" << std::endl;
+        std::cout << "                        - add up the result files of a split and report the count below each root move" << std::endl;
+        std::cout << "  perft serve           - read commands from stdin and answer on stdout until quit, keeping the table and threads between them:" << std::endl;
+        std::cout << "                          position startpos|fen [fen] [moves ...], go perft [depth], divide [depth]," << std::endl;
+        std::cout << "                          setoption hash [megabytes], setoption threads [count], stop, isready, quit" << std::endl;
         std::cout << "  perft help            - this information" << std::endl;
+        std::cout << std::endl;
+        std::cout << "Options:" << std::endl;
+        std::cout << "  -divide               - show the node count for each move from the root position" << std::endl;
+        std::cout << "  -copy                 - copy the board at each ply rather than undoing moves" << std::endl;
+        std::cout << "  -verify-against [backend]" << std::endl;
+        std::cout << "                        - walk the tree with another backend too (scalar, avx2, copymake or makeunmake) and stop at the first difference" << std::endl;
+        std::cout << "  -stats                - count captures, checks, mates and so on, and the branching factor, at each ply" << std::endl;
+        std::cout << "  -cache [filename]     - keep results in a cache file that is reused from run to run" << std::endl;
+        std::cout << "  -cacheplies [plies]   - how many plies below the root to use the cache (default 2)" << std::endl;
+        std::cout << "  -hash [megabytes]     - use a transposition table of this size" << std::endl;
+        std::cout << "  -symmetric            - share cache and table entries between positions and their mirrors (color-flipped, and left-right once castling rights are gone)" << std::endl;
+        std::cout << "  -shared [name]        - share the transposition table with other perft processes on this machine using the same name, -hash sizing it" << std::endl;
+        std::cout << "  -disk [filename]      - back the transposition table with a much larger one on disk" << std::endl;
+        std::cout << "  -disksize [gigabytes] - size of the disk table (default 16)" << std::endl;
+        std::cout << "  -diskdepth [depth]    - smallest remaining depth kept on disk (default 6)" << std::endl;
+        std::cout << "  -checkpoint [filename]" << std::endl;
+        std::cout << "                        - record each root move's count in this file as it finishes" << std::endl;
+        std::cout << "  -checkpointplies [plies]" << std::endl;
+        std::cout << "                        - record subtrees down to this many plies below the root (default 1)" << std::endl;
+        std::cout << "  -resume               - skip the subtrees already recorded in the checkpoint file" << std::endl;
+        std::cout << "  -bfs [plies]          - expand this many plies breadth-first, merging transpositions, before searching depth-first" << std::endl;
+        std::cout << "  -samples [count]      - random walks for an estimate (default 1000000, unless -seconds is given)" << std::endl;
+        std::cout << "  -seconds [seconds]    - time to spend on an estimate" << std::endl;
+        std::cout << "  -setsize [megabytes]  - memory for unique positions before spilling them to disk (default 1024)" << std::endl;
+        std::cout << "  -spill [filename]     - file for spilled unique positions (default unique.spill)" << std::endl;
+        std::cout << "  -split [plies]        - ply to split a distributed search into units at (default 3)" << std::endl;
+        std::cout << "  -port [port]          - port the coordinator listens for workers on (default 4747)" << std::endl;
+        std::cout << "  -listen [address]     - address the coordinator listens on (default 127.0.0.1 with -workers above 0, otherwise 0.0.0.0)" << std::endl;
+        std::cout << "                          anyone who can reach it can take units and send results, so only open it on a trusted network" << std::endl;
+        std::cout << "  -shards [count]       - files to share the units of a split between (default 1)" << std::endl;
+        std::cout << "  -prefix [name]        - start of the names of the units files of a split (default perft)" << std::endl;
+        std::cout << "  -workers [count]      - workers the coordinator starts on this machine (default one per core, 0 for none)" << std::endl;
     }
 }
 
@@ -55,6 +126,26 @@ bool processCommandLine( int argc, const char** argv )
 {
     std::vector<std::string> args;
     bool divide = false;
+    std::string cacheFilename;
+    int cachePlies = 2;
+    size_t hashMegabytes = 0;
+    std::string sharedName;
+    std::string diskFilename;
+    size_t diskGigabytes = 16;
+    int diskDepth = 6;
+    std::string checkpointFilename;
+    int checkpointPlies = 1;
+    bool resume = false;
+    unsigned long long samples = 0;
+    double seconds = 0;
+    size_t setMegabytes = 1024;
+    std::string spillFilename = "unique.spill";
+    int splitPlies = 3;
+    unsigned short port = 4747;
+    std::string listenAddress;
+    unsigned int localWorkers = std::max( 1u, std::thread::hardware_concurrency() );
+    unsigned int shards = 1;
+    std::string prefix = "perft";
 
     for ( size_t loop = 1; loop < argc; loop++ )
     {
@@ -63,12 +154,162 @@ bool processCommandLine( int argc, const char** argv )
         {
             divide = true;
         }
+        else if ( arg == "-copy" )
+        {
+            Test::setCopyMake( true );
+        }
+        else if ( arg == "-verify-against" && loop + 1 < argc )
+        {
+            if ( !Test::setVerifyAgainst( argv[ ++loop ] ) )
+            {
+                return false;
+            }
+        }
+        else if ( arg == "-stats" )
+        {
+            Test::setStatistics( true );
+        }
+        else if ( arg == "-cache" && loop + 1 < argc )
+        {
+            cacheFilename = argv[ ++loop ];
+        }
+        else if ( arg == "-cacheplies" && loop + 1 < argc )
+        {
+            cachePlies = atoi( argv[ ++loop ] );
+        }
+        else if ( arg == "-symmetric" )
+        {
+            Test::setSymmetricKeys( true );
+        }
+        else if ( arg == "-hash" && loop + 1 < argc )
+        {
+            hashMegabytes = atoi( argv[ ++loop ] );
+        }
+        else if ( arg == "-shared" && loop + 1 < argc )
+        {
+            sharedName = argv[ ++loop ];
+        }
+        else if ( arg == "-disk" && loop + 1 < argc )
+        {
+            diskFilename = argv[ ++loop ];
+        }
+        else if ( arg == "-disksize" && loop + 1 < argc )
+        {
+            diskGigabytes = atoi( argv[ ++loop ] );
+        }
+        else if ( arg == "-diskdepth" && loop + 1 < argc )
+        {
+            diskDepth = atoi( argv[ ++loop ] );
+        }
+        else if ( arg == "-checkpoint" && loop + 1 < argc )
+        {
+            checkpointFilename = argv[ ++loop ];
+        }
+        else if ( arg == "-checkpointplies" && loop + 1 < argc )
+        {
+            checkpointPlies = atoi( argv[ ++loop ] );
+        }
+        else if ( arg == "-resume" )
+        {
+            resume = true;
+        }
+        else if ( arg == "-bfs" && loop + 1 < argc )
+        {
+            Test::setBreadthFirst( atoi( argv[ ++loop ] ) );
+        }
+        else if ( arg == "-samples" && loop + 1 < argc )
+        {
+            samples = std::strtoull( argv[ ++loop ], nullptr, 10 );
+        }
+        else if ( arg == "-seconds" && loop + 1 < argc )
+        {
+            seconds = atof( argv[ ++loop ] );
+        }
+        else if ( arg == "-setsize" && loop + 1 < argc )
+        {
+            setMegabytes = atoi( argv[ ++loop ] );
+        }
+        else if ( arg == "-spill" && loop + 1 < argc )
+        {
+            spillFilename = argv[ ++loop ];
+        }
+        else if ( arg == "-split" && loop + 1 < argc )
+        {
+            splitPlies = atoi( argv[ ++loop ] );
+        }
+        else if ( arg == "-port" && loop + 1 < argc )
+        {
+            port = static_cast<unsigned short>( atoi( argv[ ++loop ] ) );
+        }
+        else if ( arg == "-listen" && loop + 1 < argc )
+        {
+            listenAddress = argv[ ++loop ];
+        }
+        else if ( arg == "-workers" && loop + 1 < argc )
+        {
+            localWorkers = atoi( argv[ ++loop ] );
+        }
+        else if ( arg == "-shards" && loop + 1 < argc )
+        {
+            shards = atoi( argv[ ++loop ] );
+        }
+        else if ( arg == "-prefix" && loop + 1 < argc )
+        {
+            prefix = argv[ ++loop ];
+        }
         else
         {
             args.push_back( arg );
         }
     }
 
+    if ( args.empty() )
+    {
+        return false;
+    }
+
+    // The cache is written back to its file when this goes out of scope
+    PerftCache cache;
+
+    if ( !cacheFilename.empty() && cache.open( cacheFilename ) )
+    {
+        Test::setCache( &cache, cachePlies );
+    }
+
+    Checkpoint checkpoint;
+
+    if ( !checkpointFilename.empty() && checkpoint.open( checkpointFilename, resume ) )
+    {
+        Test::setCheckpoint( &checkpoint, checkpointPlies );
+    }
+
+    // A shared table takes the size from -hash. The coordinator of a distributed search opens it too, which keeps it
+    // there while workers come and go
+    SharedTable sharedTable;
+
+    if ( !sharedName.empty() && sharedTable.open( sharedName, hashMegabytes > 0 ? hashMegabytes : 64 ) )
+    {
+        Test::setSharedTable( &sharedTable );
+
+        std::cout << "Shared table: " << ( sharedTable.isCreated() ? "created " : "attached to " ) << sharedName << ", " << sharedTable.getMegabytes() << "MB" << std::endl;
+    }
+
+    // A disk tier needs a memory tier in front of it, which is the only table of our own needed with a shared table.
+    // The coordinator of a distributed search hands the size on to its workers rather than searching itself
+    std::unique_ptr<PerftTable> table;
+
+    if ( ( ( hashMegabytes > 0 && sharedName.empty() ) || !diskFilename.empty() ) && args[ 0 ] != "distribute" )
+    {
+        table.reset( new PerftTable( hashMegabytes > 0 ? hashMegabytes : 64 ) );
+
+        if ( !diskFilename.empty() )
+        {
+            table->openDiskTier( diskFilename, diskGigabytes, diskDepth );
+        }
+
+        Test::setTable( table.get() );
+    }
+
     // Work out what we are doing
     bool executed = false;
 
@@ -137,6 +378,172 @@ bool processCommandLine( int argc, const char** argv )
             executed = Test::perftFile( filename.c_str(), divide );
         }
     }
+    else if ( arg == "batch" )
+    {
+        if ( args.size() > 2 )
+        {
+            executed = Test::perftBatch( atoi( args[ 1 ].c_str() ), args[ 2 ].c_str() );
+        }
+    }
+    else if ( arg == "benchmark" )
+    {
+        if ( args.size() > 1 )
+        {
+            std::stringstream fen;
+
+            for ( int loop = 2; loop < args.size(); loop++ )
+            {
+                if ( loop > 2 )
+                {
+                    fen << " ";
+                }
+
+                fen << args[ loop ];
+            }
+
+            executed = Test::perftBenchmark( atoi( args[ 1 ].c_str() ), args.size() > 2 ? fen.str() : Fen::startingPosition );
+        }
+    }
+    else if ( arg == "estimate" )
+    {
+        if ( args.size() > 1 )
+        {
+            std::stringstream fen;
+
+            for ( int loop = 2; loop < args.size(); loop++ )
+            {
+                if ( loop > 2 )
+                {
+                    fen << " ";
+                }
+
+                fen << args[ loop ];
+            }
+
+            // Without a budget of either kind, take a fixed number of samples
+            if ( samples == 0 && seconds <= 0 )
+            {
+                samples = 1000000;
+            }
+
+            executed = Test::perftEstimate( atoi( args[ 1 ].c_str() ), args.size() > 2 ? fen.str() : Fen::startingPosition, samples, seconds );
+        }
+    }
+    else if ( arg == "unique" )
+    {
+        if ( args.size() > 1 )
+        {
+            std::stringstream fen;
+
+            for ( int loop = 2; loop < args.size(); loop++ )
+            {
+                if ( loop > 2 )
+                {
+                    fen << " ";
+                }
+
+                fen << args[ loop ];
+            }
+
+            executed = Test::perftUnique( atoi( args[ 1 ].c_str() ), args.size() > 2 ? fen.str() : Fen::startingPosition, setMegabytes, spillFilename );
+        }
+    }
+    else if ( arg == "distribute" )
+    {
+        if ( args.size() > 1 )
+        {
+            std::stringstream fen;
+
+            for ( int loop = 2; loop < args.size(); loop++ )
+            {
+                if ( loop > 2 )
+                {
+                    fen << " ";
+                }
+
+                fen << args[ loop ];
+            }
+
+            executed = Distributed::coordinate( atoi( args[ 1 ].c_str() ), args.size() > 2 ? fen.str() : Fen::startingPosition, splitPlies, listenAddress, port, localWorkers, hashMegabytes, sharedName, divide );
+        }
+    }
+    else if ( arg == "worker" )
+    {
+        if ( args.size() > 2 )
+        {
+            executed = Distributed::work( args[ 1 ], args[ 2 ] );
+        }
+    }
+    else if ( arg == "split" )
+    {
+        if ( args.size() > 2 )
+        {
+            std::stringstream fen;
+
+            for ( int loop = 3; loop < args.size(); loop++ )
+            {
+                if ( loop > 3 )
+                {
+                    fen << " ";
+                }
+
+                fen << args[ loop ];
+            }
+
+            executed = Distributed::split( atoi( args[ 1 ].c_str() ), atoi( args[ 2 ].c_str() ), args.size() > 3 ? fen.str() : Fen::startingPosition, shards, prefix );
+        }
+    }
+    else if ( arg == "run-unit" )
+    {
+        if ( args.size() > 1 )
+        {
+            executed = Distributed::runUnits( args[ 1 ] );
+        }
+    }
+    else if ( arg == "reduce" )
+    {
+        if ( args.size() > 1 )
+        {
+            executed = Distributed::reduce( std::vector<std::string>( args.cbegin() + 1, args.cend() ) );
+        }
+    }
+    else if ( arg == "serve" )
+    {
+        // Starts with the table and cache from the command line, if any, until setoption hash replaces the table
+        Server server;
+        server.run();
+
+        executed = true;
+    }
+
+    if ( table )
+    {
+        Test::setTable( nullptr );
+
+        std::cout << "Table: " << table->getMemoryHits() << " memory hits, " << table->getDiskHits() << " disk hits from " << table->getDiskReads() << " disk reads, "
+                  << table->getDiskWrites() << " disk writes" << std::endl;
+    }
+
+    if ( sharedTable.isOpen() )
+    {
+        Test::setSharedTable( nullptr );
+
+        std::cout << "Shared table: " << sharedTable.getHits() << " hits" << std::endl;
+    }
+
+    if ( checkpoint.isOpen() )
+    {
+        Test::setCheckpoint( nullptr, 1 );
+
+        std::cout << "Checkpoint: " << checkpoint.getResumed() << " subtrees resumed, " << checkpoint.getRecorded() << " recorded" << std::endl;
+    }
+
+    if ( cache.isOpen() )
+    {
+        Test::setCache( nullptr, 0 );
+
+        std::cout << "Cache: " << cache.getHits() << " hits from " << cache.getLookups() << " lookups" << std::endl;
+    }
 
     return executed;
 }